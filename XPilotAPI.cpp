@@ -28,10 +28,30 @@
 #include <cstring>
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <deque>
+#include <numeric>
+#include <thread>
 
 #include "XPilotAPI.h"
 
+#ifndef XPILOTAPI_NO_XPLM
 #include <XPLMPlugin.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef max
+#undef max
+#endif
 
 #ifdef min
 #undef min
@@ -39,17 +59,28 @@
 
 #define XPILOT_PLUGIN_SIGNATURE "org.vatsim.xpilot"
 
-#define ASSIGN_DR_NAME(var,drName,dataRef,type)     \
-static XPilotDataRef DR##drName(dataRef);           \
-var = DR##drName.get##type();
-
-#define RETURN_DR(dataRef,type)   \
-static XPilotDataRef DR(dataRef); \
-return DR.get##type();
+// Sent by X-Plane 12 when plugins registered new dataRefs
+#ifndef XPLM_MSG_DATAREFS_ADDED
+#define XPLM_MSG_DATAREFS_ADDED 114
+#endif
 
 #define ZERO_TERM(str) str[sizeof(str)-1] = 0
 
 namespace XPilotAPI {
+    constexpr double PI = 3.14159265358979323846;
+    constexpr double EARTH_RADIUS_NM = 3440.065;
+
+    inline double deg2rad(double deg) { return deg * (PI / 180.0); }
+
+    // Great circle distance between two positions in nautical miles (haversine)
+    double distNm(double lat1, double lon1, double lat2, double lon2)
+    {
+        const double sLat = std::sin(deg2rad(lat2 - lat1) / 2.0);
+        const double sLon = std::sin(deg2rad(lon2 - lon1) / 2.0);
+        const double a = sLat * sLat + std::cos(deg2rad(lat1)) * std::cos(deg2rad(lat2)) * sLon * sLon;
+        return 2.0 * EARTH_RADIUS_NM * std::asin(std::min(1.0, std::sqrt(a)));
+    }
+
     std::string hexStr(uint64_t n, unsigned minChars = 6)
     {
         char buf[11] = { 0,0,0,0,0,0,0,0,0,0,0 };
@@ -72,19 +103,213 @@ namespace XPilotAPI {
     }
 }
 
+//
+// MARK: XPilotAPIHistory
+//
+
+void
+XPilotAPIHistory::setCapacity(int n)
+{
+    vSamples.resize(size_t(std::max(0, n)));
+    vSamples.shrink_to_fit();
+    clear();
+}
+
+void
+XPilotAPIHistory::push(const XPilotAPIPosSample& s)
+{
+    if (vSamples.empty())
+        return;
+    vSamples[size_t(head)] = s;
+    head = (head + 1) % capacity();
+    if (count < capacity())
+        count++;
+}
+
+XPilotAPIHistory::ResultTy
+XPilotAPIHistory::positionAt(std::chrono::steady_clock::time_point t, XPilotAPIPosSample& out,
+                             std::chrono::duration<double> maxExtrapolation) const
+{
+    if (empty())
+        return POS_NONE;
+
+    if (t < at(0).ts) {
+        out = at(0);
+        return POS_OLDEST;
+    }
+
+    const XPilotAPIPosSample& last = newest();
+    if (t > last.ts) {
+        // dead reckoning along a great circle with constant heading and speed
+        const double dt = std::min(std::chrono::duration<double>(t - last.ts).count(),
+                                   maxExtrapolation.count());
+        const double delta = last.speed_kt * dt / 3600.0 / XPilotAPI::EARTH_RADIUS_NM;
+        const double hdg = XPilotAPI::deg2rad(last.heading);
+        const double lat1 = XPilotAPI::deg2rad(last.lat);
+        const double lat2 = std::asin(std::sin(lat1) * std::cos(delta) +
+                                      std::cos(lat1) * std::sin(delta) * std::cos(hdg));
+        const double dLon = std::atan2(std::sin(hdg) * std::sin(delta) * std::cos(lat1),
+                                       std::cos(delta) - std::sin(lat1) * std::sin(lat2));
+        out = last;
+        out.ts = t;
+        out.lat = lat2 * 180.0 / XPilotAPI::PI;
+        out.lon = std::remainder(last.lon + dLon * 180.0 / XPilotAPI::PI, 360.0);
+        return POS_EXTRAPOLATED;
+    }
+
+    // binary search for the first sample not before `t`
+    int lo = 0, hi = count - 1;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (at(mid).ts < t)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    const XPilotAPIPosSample& b = at(lo);
+    if (lo == 0 || b.ts == t) {
+        out = b;
+        return POS_INTERPOLATED;
+    }
+
+    // linear interpolation between `a` and `b`, taking care of wrap-around in longitude and heading
+    const XPilotAPIPosSample& a = at(lo - 1);
+    const double f = std::chrono::duration<double>(t - a.ts).count() /
+                     std::chrono::duration<double>(b.ts - a.ts).count();
+    out.ts = t;
+    out.lat = a.lat + f * (b.lat - a.lat);
+    out.lon = std::remainder(a.lon + f * std::remainder(b.lon - a.lon, 360.0), 360.0);
+    out.alt_ft = a.alt_ft + f * (b.alt_ft - a.alt_ft);
+    out.heading = float(std::fmod(a.heading + f * std::remainder(double(b.heading) - a.heading, 360.0) + 360.0, 360.0));
+    out.speed_kt = float(a.speed_kt + f * (b.speed_kt - a.speed_kt));
+    return POS_INTERPOLATED;
+}
+
+//
+// MARK: XPilotAPIStrPool
+//
+
+namespace {
+    // Storage of the string pool: `dqStr` owns the texts (a deque never moves
+    // its elements), `mapId` indexes views onto them
+    struct StrPoolTy {
+        std::deque<std::string> dqStr;
+        std::unordered_map<std::string_view, XPilotAPIStrId> mapId;
+
+        StrPoolTy() {
+            dqStr.emplace_back();
+            mapId.emplace(std::string_view(dqStr.back()), 0);
+        }
+    };
+
+    StrPoolTy& GetStrPool()
+    {
+        static StrPoolTy pool;
+        return pool;
+    }
+}
+
+XPilotAPIStrId
+XPilotAPIStrPool::intern(std::string_view s)
+{
+    StrPoolTy& pool = GetStrPool();
+    auto iter = pool.mapId.find(s);
+    if (iter != pool.mapId.end())
+        return iter->second;
+
+    const XPilotAPIStrId id = XPilotAPIStrId(pool.dqStr.size());
+    pool.dqStr.emplace_back(s);
+    pool.mapId.emplace(std::string_view(pool.dqStr.back()), id);
+    return id;
+}
+
+XPilotAPIStrId
+XPilotAPIStrPool::find(std::string_view s)
+{
+    const StrPoolTy& pool = GetStrPool();
+    auto iter = pool.mapId.find(s);
+    return iter == pool.mapId.end() ? NO_ID : iter->second;
+}
+
+const std::string&
+XPilotAPIStrPool::str(XPilotAPIStrId id)
+{
+    const StrPoolTy& pool = GetStrPool();
+    return id < pool.dqStr.size() ? pool.dqStr[id] : pool.dqStr.front();
+}
+
+int
+XPilotAPIStrPool::size()
+{
+    return (int)GetStrPool().dqStr.size();
+}
+
+//
+// MARK: XPilotAPIAircraft
+//
+
 XPilotAPIAircraft::XPilotAPIAircraft()
 {}
 
 XPilotAPIAircraft::~XPilotAPIAircraft()
 {}
 
+void
+XPilotAPIAircraft::recycle()
+{
+    keyNum = 0;
+    bHasKey = false;
+    key.clear();
+    bulk = XPilotAPIBulkData();
+    info = XPilotAPIBulkInfoTexts();
+    idModelIcao = idAcClass = idWtc = idOrigin = idDestination = 0;
+    description.clear();
+    bDescrValid = false;
+    history.clear();
+    kin = XPilotAPIKinematics();
+    bUpdated = false;
+    dirty = DIRTY_ALL;
+}
+
+void
+XPilotAPIAircraft::addHistorySample(std::chrono::steady_clock::time_point ts)
+{
+    XPilotAPIPosSample s;
+    s.ts = ts;
+    s.lat = bulk.lat;
+    s.lon = bulk.lon;
+    s.alt_ft = bulk.alt_ft;
+    s.heading = bulk.heading;
+    s.speed_kt = bulk.speed_kt;
+    history.push(s);
+}
+
+// Returns the key as hex string, which is only built on first request
 std::string
+XPilotAPIAircraft::getKey() const
+{
+    return getKeyRef();
+}
+
+const std::string&
+XPilotAPIAircraft::getKeyRef() const
+{
+    if (key.empty() && bHasKey)
+        key = XPilotAPI::hexStr(keyNum);
+    return key;
+}
+
+// Builds the description only if texts changed since the last call
+const std::string&
 XPilotAPIAircraft::getDescription() const
 {
-    std::string ret;
+    if (bDescrValid)
+        return description;
+
+    std::string& ret = description;
 
     // 1. identifier
-    ret = info.callSign[0] ? info.callSign : key;
+    ret = info.callSign[0] ? info.callSign : getKeyRef();
 
     // 2. a/c type
     if (info.modelIcao[0]) {
@@ -101,227 +326,3510 @@ XPilotAPIAircraft::getDescription() const
         ret += info.destination[0] ? info.destination : "?";
     }
 
+    bDescrValid = true;
+    return ret;
+}
+
+// Copies the first `inSize` bytes of a record, xPilot's record size,
+// fields beyond keep their default values
+template <class T>
+static T CopyRecordPrefix(const T& rec, size_t inSize)
+{
+    T ret;
+    memcpy(static_cast<void*>(&ret), &rec, std::min(inSize, sizeof(T)));
     return ret;
 }
 
 // Copies the provided `bulk` data and sets `bUpdated` to `true`
 // if the provided data matches this aircraft.
-// @note This function can _set_ this object's `key` for the first and only time.
+// Only the first `__inSize` bytes are taken, the size of xPilot's record.
+// @note This function can _set_ this object's `keyNum` for the first and only time.
 bool
 XPilotAPIAircraft::updateAircraft(const XPilotAPIBulkData& __bulk, size_t __inSize)
 {
-    if (key.empty()) {
-        keyNum = (unsigned)__bulk.keyNum;
-        key = XPilotAPI::hexStr(__bulk.keyNum);
+    if (__inSize < sizeof(__bulk.keyNum))
+        return false;
+    if (!bHasKey) {
+        keyNum = __bulk.keyNum;
+        bHasKey = true;
     }
     else {
         if (__bulk.keyNum != keyNum)
             return false;
     }
 
-    bulk = __bulk;
+    const XPilotAPIBulkData newBulk = CopyRecordPrefix(__bulk, __inSize);
+    dirty = (dirty & DIRTY_TEXT) | diff(bulk, newBulk);
+    bulk = newBulk;
     bUpdated = true;
     return true;
 }
 
 // Copies the provided `info` data and sets `bUpdated` to `true`
 // if the provided data matches this aircraft.
+// Only the first `__inSize` bytes are taken, the size of xPilot's record.
 bool
 XPilotAPIAircraft::updateAircraft(const XPilotAPIBulkInfoTexts& __info, size_t __inSize)
 {
-    if (__info.keyNum != keyNum)
+    if (__inSize < sizeof(__info.keyNum) || __info.keyNum != keyNum)
         return false;
 
-    info = __info;
+    XPilotAPIBulkInfoTexts newInfo = CopyRecordPrefix(__info, __inSize);
+
+    ZERO_TERM(newInfo.modelIcao);
+    ZERO_TERM(newInfo.acClass);
+    ZERO_TERM(newInfo.wtc);
+    ZERO_TERM(newInfo.callSign);
+    ZERO_TERM(newInfo.squawk);
+    ZERO_TERM(newInfo.origin);
+    ZERO_TERM(newInfo.destination);
+    ZERO_TERM(newInfo.cslModel);
 
-    ZERO_TERM(info.modelIcao);
-    ZERO_TERM(info.callSign);
-    ZERO_TERM(info.squawk);
-    ZERO_TERM(info.origin);
-    ZERO_TERM(info.destination);
-    ZERO_TERM(info.cslModel);
+    const uint32_t textDirty = diff(info, newInfo);
+    dirty = (dirty & DIRTY_BULK) | textDirty;
+    if (textDirty) {
+        info = newInfo;
+        if (textDirty & DIRTY_MODEL) {
+            idModelIcao = XPilotAPIStrPool::intern(info.modelIcao);
+            idAcClass = XPilotAPIStrPool::intern(info.acClass);
+            idWtc = XPilotAPIStrPool::intern(info.wtc);
+        }
+        if (textDirty & DIRTY_ROUTE) {
+            idOrigin = XPilotAPIStrPool::intern(info.origin);
+            idDestination = XPilotAPIStrPool::intern(info.destination);
+        }
+        bDescrValid = false;
+    }
+    info.keyNum = newInfo.keyNum;
 
     bUpdated = true;
     return true;
 }
 
-XPilotAPIConnect::XPilotAPIConnect(fCreateAcObject* _pfCreateAcObject, int numBulkAc) :
-    iBulkAc(numBulkAc < 1 ? 1 : numBulkAc > 100 ? 100 : numBulkAc),
-    vBulkNum(new XPilotAPIAircraft::XPilotAPIBulkData[iBulkAc]),
-    vInfoTexts(new XPilotAPIAircraft::XPilotAPIBulkInfoTexts[iBulkAc]),
-    pfCreateAcObject(_pfCreateAcObject)
-{}
+uint32_t
+XPilotAPIAircraft::diff(const XPilotAPIBulkData& a, const XPilotAPIBulkData& b)
+{
+    uint32_t ret = 0;
+    if (a.lat != b.lat || a.lon != b.lon || a.alt_ft != b.alt_ft)
+        ret |= DIRTY_POS;
+    if (a.heading != b.heading || a.roll != b.roll || a.pitch != b.pitch)
+        ret |= DIRTY_ATTITUDE;
+    if (a.speed_kt != b.speed_kt)
+        ret |= DIRTY_SPEED;
+    if (a.terrainAlt_ft != b.terrainAlt_ft)
+        ret |= DIRTY_TERRAIN;
+    if (a.flaps != b.flaps || a.gear != b.gear)
+        ret |= DIRTY_CONFIG;
+    if (a.bits.taxi != b.bits.taxi || a.bits.land != b.bits.land || a.bits.bcn != b.bits.bcn ||
+        a.bits.strb != b.bits.strb || a.bits.nav != b.bits.nav)
+        ret |= DIRTY_LIGHTS;
+    if (a.bits.onGnd != b.bits.onGnd)
+        ret |= DIRTY_GND;
+    if (a.bits.multiIdx != b.bits.multiIdx)
+        ret |= DIRTY_MULTIIDX;
+    if (a.bearing != b.bearing || a.dist_nm != b.dist_nm)
+        ret |= DIRTY_CAMERA;
+    return ret;
+}
 
-bool 
-XPilotAPIConnect::doesXPilotControlAI()
+// Compares text fields up to the last but one character,
+// so that a record as received compares equal to its zero-terminated copy
+#define TEXT_DIFFERS(a,b,field) strncmp(a.field, b.field, sizeof(a.field)-1)
+
+uint32_t
+XPilotAPIAircraft::diff(const XPilotAPIBulkInfoTexts& a, const XPilotAPIBulkInfoTexts& b)
 {
-    RETURN_DR("xpilot/ai_controlled", Bool);
+    uint32_t ret = 0;
+    if (TEXT_DIFFERS(a, b, callSign))
+        ret |= DIRTY_CALLSIGN;
+    if (TEXT_DIFFERS(a, b, modelIcao) || TEXT_DIFFERS(a, b, acClass) || TEXT_DIFFERS(a, b, wtc))
+        ret |= DIRTY_MODEL;
+    if (TEXT_DIFFERS(a, b, squawk))
+        ret |= DIRTY_SQUAWK;
+    if (TEXT_DIFFERS(a, b, origin) || TEXT_DIFFERS(a, b, destination))
+        ret |= DIRTY_ROUTE;
+    if (TEXT_DIFFERS(a, b, cslModel))
+        ret |= DIRTY_CSL;
+    return ret;
 }
 
-int 
-XPilotAPIConnect::getXPilotNumAc()
+//
+// MARK: XPilotAPIChangeSet
+//
+
+void
+XPilotAPIChangeSet::clear()
 {
-    RETURN_DR("xpilot/num_aircraft", Int);
+    added.clear();
+    removed.clear();
+    posUpdated.clear();
+    textChanged.clear();
+    vRemovedAc.clear();
 }
 
-const 
-MapXPilotAPIAircraft& XPilotAPIConnect::UpdateAcList(ListXPilotAPIAircraft* plistRemovedAc)
+//
+// MARK: XPilotAPIFleetSoA
+//
+
+void
+XPilotAPIFleetSoA::push_back(uint64_t _keyNum)
 {
-    static XPilotDataRef DRquick("xpilot/bulk/quick");
-    static XPilotDataRef DRexpsv("xpilot/bulk/expensive");
+    keyNum.push_back(_keyNum);
+    lat.push_back(0.0);
+    lon.push_back(0.0);
+    alt_ft.push_back(0.0);
+    heading.push_back(0.0f);
+    speed_kt.push_back(0.0f);
+    dist_nm.push_back(0.0f);
+    bearing.push_back(0.0f);
+    bits.push_back(0);
+    multiIdx.push_back(0);
+    ts.push_back(0.0);
+    vsi_fpm.push_back(0.0f);
+    turnRate_dps.push_back(0.0f);
+    track.push_back(0.0f);
+    accel_kts.push_back(0.0f);
+}
 
-    const int numAc = isXPilotAvail() && DRquick.isValid() && DRexpsv.isValid() ? getXPilotNumAc() : 0;
-    if (numAc <= 0) {
-        if (plistRemovedAc) {
-            for (MapXPilotAPIAircraft::value_type& p : mapAc) {
-                plistRemovedAc->emplace_back(std::move(p.second));
-            }
-        }
-        mapAc.clear();
-        return mapAc;
-    }
+void
+XPilotAPIFleetSoA::set(int i, const XPilotAPIAircraft::XPilotAPIBulkData& bulk)
+{
+    const size_t idx = size_t(i);
+    keyNum[idx]     = bulk.keyNum;
+    lat[idx]        = bulk.lat;
+    lon[idx]        = bulk.lon;
+    alt_ft[idx]     = bulk.alt_ft;
+    heading[idx]    = bulk.heading;
+    speed_kt[idx]   = bulk.speed_kt;
+    dist_nm[idx]    = bulk.dist_nm;
+    bearing[idx]    = bulk.bearing;
+    bits[idx]       = uint8_t((bulk.bits.onGnd  ? BIT_ON_GND : 0) |
+                              (bulk.bits.taxi   ? BIT_TAXI   : 0) |
+                              (bulk.bits.land   ? BIT_LAND   : 0) |
+                              (bulk.bits.bcn    ? BIT_BCN    : 0) |
+                              (bulk.bits.strb   ? BIT_STRB   : 0) |
+                              (bulk.bits.nav    ? BIT_NAV    : 0));
+    multiIdx[idx]   = int8_t(bulk.bits.multiIdx);
+}
 
-    for (MapXPilotAPIAircraft::value_type& p : mapAc) {
-        p.second->resetUpdated();
-    }
+void
+XPilotAPIFleetSoA::set(int i, double _ts, const XPilotAPIKinematics& kin)
+{
+    const size_t idx = size_t(i);
+    ts[idx]             = _ts;
+    vsi_fpm[idx]        = kin.vsi_fpm;
+    turnRate_dps[idx]   = kin.turnRate_dps;
+    track[idx]          = kin.track;
+    accel_kts[idx]      = kin.accel_kts;
+}
+
+// Moves the last element of `v` into index `i` and shrinks `v`
+template <class V>
+static void SwapPop(V& v, size_t i)
+{
+    if (i + 1 != v.size())
+        v[i] = std::move(v.back());
+    v.pop_back();
+}
+
+void
+XPilotAPIFleetSoA::eraseAt(int i)
+{
+    const size_t idx = size_t(i);
+    SwapPop(keyNum, idx);
+    SwapPop(lat, idx);
+    SwapPop(lon, idx);
+    SwapPop(alt_ft, idx);
+    SwapPop(heading, idx);
+    SwapPop(speed_kt, idx);
+    SwapPop(dist_nm, idx);
+    SwapPop(bearing, idx);
+    SwapPop(bits, idx);
+    SwapPop(multiIdx, idx);
+    SwapPop(ts, idx);
+    SwapPop(vsi_fpm, idx);
+    SwapPop(turnRate_dps, idx);
+    SwapPop(track, idx);
+    SwapPop(accel_kts, idx);
+}
+
+void
+XPilotAPIFleetSoA::clear()
+{
+    keyNum.clear();
+    lat.clear();
+    lon.clear();
+    alt_ft.clear();
+    heading.clear();
+    speed_kt.clear();
+    dist_nm.clear();
+    bearing.clear();
+    bits.clear();
+    multiIdx.clear();
+    ts.clear();
+    vsi_fpm.clear();
+    turnRate_dps.clear();
+    track.clear();
+    accel_kts.clear();
+}
 
-    int sizeXPStruct = 0;
-    if (DoBulkFetch<XPilotAPIAircraft::XPilotAPIBulkData>(numAc, DRquick, sizeXPStruct, vBulkNum)
-        || std::chrono::steady_clock::now() - lastExpsvFetch > sPeriodExpsv)
+void
+XPilotAPIFleetSoA::reserve(int n)
+{
+    const size_t num = size_t(n);
+    keyNum.reserve(num);
+    lat.reserve(num);
+    lon.reserve(num);
+    alt_ft.reserve(num);
+    heading.reserve(num);
+    speed_kt.reserve(num);
+    dist_nm.reserve(num);
+    bearing.reserve(num);
+    bits.reserve(num);
+    multiIdx.reserve(num);
+    ts.reserve(num);
+    vsi_fpm.reserve(num);
+    turnRate_dps.reserve(num);
+    track.reserve(num);
+    accel_kts.reserve(num);
+}
+
+//
+// MARK: XPilotAPIAcStore
+//
+
+int
+XPilotAPIAcStore::find(uint64_t keyNum) const
+{
+    if (vHash.empty())
+        return -1;
+    const size_t mask = vHash.size() - 1;
+    for (size_t slot = hashSlot(keyNum); vHash[slot]; slot = (slot + 1) & mask)
     {
-        sizeXPStruct = 0;
-        DoBulkFetch<XPilotAPIAircraft::XPilotAPIBulkInfoTexts>(numAc, DRexpsv, sizeXPStruct, vInfoTexts);
-        lastExpsvFetch = std::chrono::steady_clock::now();
+        const int idx = vHash[slot] - 1;
+        if (vKeys[size_t(idx)] == keyNum)
+            return idx;
     }
+    return -1;
+}
+
+SPtrXPilotAPIAircraft
+XPilotAPIAcStore::get(uint64_t keyNum) const
+{
+    const int idx = find(keyNum);
+    return idx < 0 ? SPtrXPilotAPIAircraft() : vAc[size_t(idx)];
+}
+
+int
+XPilotAPIAcStore::insert(uint64_t keyNum, SPtrXPilotAPIAircraft&& pAc)
+{
+    assert(find(keyNum) < 0);
+    // keep the load factor of the hash table at or below 50%
+    if ((vAc.size() + 1) * 2 > vHash.size())
+        rehash(std::max<size_t>(16, vHash.size() * 2));
+
+    const int idx = (int)vAc.size();
+    vAc.emplace_back(std::move(pAc));
+    vKeys.push_back(keyNum);
+
+    const size_t mask = vHash.size() - 1;
+    size_t slot = hashSlot(keyNum);
+    while (vHash[slot])
+        slot = (slot + 1) & mask;
+    vHash[slot] = idx + 1;
+    return idx;
+}
+
+// Removes the hash table entry of index `i` using backward-shift deletion,
+// then moves the last aircraft into index `i`
+void
+XPilotAPIAcStore::eraseAt(int i)
+{
+    assert(0 <= i && i < size());
+    const size_t mask = vHash.size() - 1;
 
-    for (MapXPilotAPIAircraft::iterator iter = mapAc.begin(); iter != mapAc.end();)
+    // find the slot pointing to `i`
+    size_t slot = hashSlot(vKeys[size_t(i)]);
+    while (vHash[slot] != i + 1)
+        slot = (slot + 1) & mask;
+
+    // shift back following entries, which could otherwise no longer be found
+    for (size_t next = (slot + 1) & mask; vHash[next]; next = (next + 1) & mask)
     {
-        if (!iter->second->isUpdated()) {
-            if (plistRemovedAc) {
-                plistRemovedAc->emplace_back(std::move(iter->second));
-            }
-            iter = mapAc.erase(iter);
-        }
-        else {
-            iter++;
+        const size_t home = hashSlot(vKeys[size_t(vHash[next] - 1)]);
+        // can the entry at `next` move to `slot`? Only if its home slot is not within (slot, next]
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            vHash[slot] = vHash[next];
+            slot = next;
         }
     }
-    return mapAc;
+    vHash[slot] = 0;
+
+    // move the last aircraft into the freed index
+    const int last = size() - 1;
+    if (i != last) {
+        size_t lastSlot = hashSlot(vKeys[size_t(last)]);
+        while (vHash[lastSlot] != last + 1)
+            lastSlot = (lastSlot + 1) & mask;
+        vHash[lastSlot] = i + 1;
+        vAc[size_t(i)] = std::move(vAc[size_t(last)]);
+        vKeys[size_t(i)] = vKeys[size_t(last)];
+    }
+    vAc.pop_back();
+    vKeys.pop_back();
 }
 
-// Finds an aircraft for a given multiplayer slot
-SPtrXPilotAPIAircraft 
-XPilotAPIConnect::getAcByMultIdx(int multiIdx) const
+void
+XPilotAPIAcStore::clear()
 {
-    if (multiIdx < 1) {
-        return SPtrXPilotAPIAircraft();
+    vAc.clear();
+    vKeys.clear();
+    std::fill(vHash.begin(), vHash.end(), 0);
+}
+
+void
+XPilotAPIAcStore::reserve(int n)
+{
+    vAc.reserve(size_t(n));
+    vKeys.reserve(size_t(n));
+    if (size_t(n) * 2 > vHash.size()) {
+        size_t numSlots = 16;
+        while (numSlots < size_t(n) * 2)
+            numSlots *= 2;
+        rehash(numSlots);
     }
+}
 
-    MapXPilotAPIAircraft::const_iterator iter =
-        std::find_if(mapAc.cbegin(), mapAc.cend(),
-            [multiIdx](const MapXPilotAPIAircraft::value_type& pair)
-    { return pair.second->getMultiIdx() == multiIdx; });
+// Resizes the hash table to `numSlots` (a power of 2) and re-inserts all keys
+void
+XPilotAPIAcStore::rehash(size_t numSlots)
+{
+    assert((numSlots & (numSlots - 1)) == 0);
+    hashShift = 64;
+    for (size_t n = numSlots; n > 1; n >>= 1)
+        hashShift--;
+    vHash.assign(numSlots, 0);
 
-    return iter == mapAc.cend() ? SPtrXPilotAPIAircraft() : iter->second;
+    const size_t mask = numSlots - 1;
+    for (size_t idx = 0; idx < vKeys.size(); idx++)
+    {
+        size_t slot = hashSlot(vKeys[idx]);
+        while (vHash[slot])
+            slot = (slot + 1) & mask;
+        vHash[slot] = int(idx) + 1;
+    }
 }
 
-// fetch bulk data and create/update aircraft objects
-template <class T>
-bool XPilotAPIConnect::DoBulkFetch(int numAc, XPilotDataRef& DR, int& outSizeXP,
-    std::unique_ptr<T[]>& vBulk)
+//
+// MARK: XPilotAPIQuery
+//
+
+bool
+XPilotAPIQuery::matches(const XPilotAPIAircraft& ac) const
 {
-    bool ret = false;
+    if (gnd != GND_ANY && ac.isOnGround() != (gnd == GND_ONLY))
+        return false;
+    const double alt = ac.getAltFt();
+    if (alt < altMinFt || alt > altMaxFt)
+        return false;
+    const float dist = ac.getDistNm();
+    if (dist < distMinNm || dist > distMaxNm)
+        return false;
+    return (!wtc || ac.getWtcId() == wtc) &&
+           (!acClass || ac.getAcClassId() == acClass) &&
+           (!origin || ac.getOriginId() == origin) &&
+           (!destination || ac.getDestinationId() == destination);
+}
 
-    outSizeXP = DR.getData(NULL, 0, sizeof(T));
+uint32_t
+XPilotAPIQuery::getDirtyMask() const
+{
+    uint32_t mask = 0;
+    if (gnd != GND_ANY)
+        mask |= XPilotAPIAircraft::DIRTY_GND;
+    if (altMinFt > -std::numeric_limits<double>::infinity() ||
+        altMaxFt < std::numeric_limits<double>::infinity() || sortBy == SORT_ALT)
+        mask |= XPilotAPIAircraft::DIRTY_POS;
+    if (distMinNm > 0.0f || distMaxNm < std::numeric_limits<float>::infinity() || sortBy == SORT_DIST)
+        mask |= XPilotAPIAircraft::DIRTY_CAMERA;
+    if (wtc || acClass)
+        mask |= XPilotAPIAircraft::DIRTY_MODEL;
+    if (origin || destination)
+        mask |= XPilotAPIAircraft::DIRTY_ROUTE;
+    if (sortBy == SORT_SPEED)
+        mask |= XPilotAPIAircraft::DIRTY_SPEED;
+    if (sortBy == SORT_CALLSIGN)
+        mask |= XPilotAPIAircraft::DIRTY_CALLSIGN;
+    return mask;
+}
 
-    for (int ac = 0;
-        ac < numAc;
-        ac += iBulkAc)
-    {
-        const int acRcvd = std::min(DR.getData(vBulk.get(),
-            ac * sizeof(T),
-            iBulkAc * sizeof(T)) / int(sizeof(T)),
-            iBulkAc);
+//
+// MARK: XPilotAPIView
+//
 
-        for (int i = 0; i < acRcvd; i++)
-        {
-            const T& bulk = vBulk[i];
+XPilotAPIView::XPilotAPIView(int _id, const XPilotAPIQuery& _query) :
+    id(_id), query(_query), dirtyMask(_query.getDirtyMask())
+{}
 
-            const std::string key = XPilotAPI::hexStr(bulk.keyNum);
-            MapXPilotAPIAircraft::iterator iter = mapAc.find(key);
-            if (iter == mapAc.end())
-            {
-                assert(pfCreateAcObject);
-                iter = mapAc.emplace(key, pfCreateAcObject()).first;
-                ret = true;
-            }
+XPilotAPIView::EntryTy
+XPilotAPIView::MakeEntry(XPilotAPIAircraft* pAc) const
+{
+    EntryTy e;
+    e.keyNum = pAc->getKeyNum();
+    e.pAc = pAc;
+    switch (query.sortBy) {
+    case XPilotAPIQuery::SORT_NONE:     break;
+    case XPilotAPIQuery::SORT_DIST:     e.val = pAc->getDistNm(); break;
+    case XPilotAPIQuery::SORT_ALT:      e.val = pAc->getAltFt(); break;
+    case XPilotAPIQuery::SORT_SPEED:    e.val = pAc->getSpeedKn(); break;
+    case XPilotAPIQuery::SORT_CALLSIGN: {
+        // first 8 characters big-endian, so that integer order is text order
+        const std::string_view cs = pAc->getCallSignView();
+        for (size_t i = 0; i < 8; i++)
+            e.txt = (e.txt << 8) | (i < cs.size() ? uint8_t(cs[i]) : 0);
+        break;
+    }
+    }
+    // NaN would break the order
+    if (std::isnan(e.val))
+        e.val = std::numeric_limits<double>::infinity();
+    if (query.bDescending) {
+        e.val = -e.val;
+        e.txt = ~e.txt;
+    }
+    return e;
+}
 
-            assert(iter != mapAc.end());
-            iter->second->updateAircraft(bulk, outSizeXP);
+// Sorting all is cheaper than inserting if more than a quarter of all aircraft changed
+void
+XPilotAPIView::Rebuild(const XPilotAPIAcStore& store)
+{
+    vPrevKeys.clear();
+    for (int i = 0; i < size(); i++)
+        vPrevKeys.push_back(vEntries[size_t(i)].keyNum);
+
+    vEntries.clear();
+    mapEntries.clear();
+    for (const SPtrXPilotAPIAircraft& pAc : store) {
+        if (query.matches(*pAc)) {
+            const EntryTy e = MakeEntry(pAc.get());
+            vEntries.push_back(e);
+            mapEntries.emplace(e.keyNum, e);
         }
     }
-    return ret;
+    std::sort(vEntries.begin(), vEntries.end());
+
+    bChanged = size() != int(vPrevKeys.size());
+    for (int i = 0; !bChanged && i < size(); i++)
+        bChanged = vEntries[size_t(i)].keyNum != vPrevKeys[size_t(i)];
 }
 
-XPilotAPIConnect::~XPilotAPIConnect()
-{}
+void
+XPilotAPIView::Apply(const XPilotAPIChangeSet& changes, const XPilotAPIAcStore& store)
+{
+    bChanged = false;
+    const size_t numEv = changes.added.size() + changes.removed.size() +
+        ((dirtyMask & XPilotAPIAircraft::DIRTY_BULK) ? changes.posUpdated.size() : 0) +
+        ((dirtyMask & XPilotAPIAircraft::DIRTY_TEXT) ? changes.textChanged.size() : 0);
+    if (numEv == 0)
+        return;
+    if (numEv * 4 > size_t(store.size())) {
+        Rebuild(store);
+        return;
+    }
 
-bool 
-XPilotAPIConnect::isXPilotAvail()
+    for (const XPilotAPIAcEvent& ev : changes.added)
+        Update(ev.pAc);
+    for (const XPilotAPIAcEvent& ev : changes.posUpdated)
+        if (ev.dirty & dirtyMask)
+            Update(ev.pAc);
+    for (const XPilotAPIAcEvent& ev : changes.textChanged)
+        if (ev.dirty & dirtyMask)
+            Update(ev.pAc);
+    // removals last, so that no event can bring back a removed aircraft
+    for (const XPilotAPIAcEvent& ev : changes.removed) {
+        auto it = mapEntries.find(ev.keyNum);
+        if (it != mapEntries.end()) {
+            Erase(it->second);
+            mapEntries.erase(it);
+        }
+    }
+}
+
+void
+XPilotAPIView::Update(XPilotAPIAircraft* pAc)
+{
+    const bool bMatch = query.matches(*pAc);
+    auto it = mapEntries.find(pAc->getKeyNum());
+    if (it == mapEntries.end()) {
+        if (bMatch)
+            Insert(MakeEntry(pAc));
+        return;
+    }
+
+    if (bMatch) {
+        const EntryTy e = MakeEntry(pAc);
+        if (e.val == it->second.val && e.txt == it->second.txt)
+            return;                     // same position
+        Erase(it->second);
+        it->second = e;
+        Insert(e);
+    }
+    else {
+        Erase(it->second);
+        mapEntries.erase(it);
+    }
+}
+
+void
+XPilotAPIView::Erase(const EntryTy& e)
 {
-    return XPLMFindPluginBySignature(XPILOT_PLUGIN_SIGNATURE) != XPLM_NO_PLUGIN_ID;
+    auto it = std::lower_bound(vEntries.begin(), vEntries.end(), e);
+    assert(it != vEntries.end() && it->keyNum == e.keyNum);
+    if (it - vEntries.begin() < size())
+        bChanged = true;
+    vEntries.erase(it);
 }
 
-XPilotDataRef::XPilotDataRef(std::string _sDataRef) :
-    sDataRef(_sDataRef)
+void
+XPilotAPIView::Insert(const EntryTy& e)
+{
+    auto it = std::upper_bound(vEntries.begin(), vEntries.end(), e);
+    it = vEntries.insert(it, e);
+    if (it - vEntries.begin() < size())
+        bChanged = true;
+    mapEntries[e.keyNum] = e;
+}
+
+//
+// MARK: XPilotAPIGeoIndex
+//
+
+XPilotAPIGeoIndex::XPilotAPIGeoIndex(double _cellDeg) :
+    cellDeg(_cellDeg),
+    numRows(int(std::ceil(180.0 / _cellDeg))),
+    numCols(int(std::ceil(360.0 / _cellDeg))),
+    vHead(size_t(numRows) * size_t(numCols), -1)
 {}
 
-bool 
-XPilotDataRef::isValid()
+int
+XPilotAPIGeoIndex::rowOf(double lat) const
 {
-    if (needsInit()) FindDataRef();
-    return bValid;
+    const int row = int(std::floor((lat + 90.0) / cellDeg));
+    return std::max(0, std::min(numRows - 1, row));
 }
 
-bool 
-XPilotDataRef::FindDataRef()
+int
+XPilotAPIGeoIndex::colOf(double lon) const
 {
-    dataRef = XPLMFindDataRef(sDataRef.c_str());
-    dataTypes = dataRef ? (XPLMGetDataRefTypes(dataRef) & usefulTypes) : xplmType_Unknown;
-    return bValid = dataTypes != xplmType_Unknown;
+    const int col = int(std::floor((lon + 180.0) / cellDeg)) % numCols;
+    return col < 0 ? col + numCols : col;
 }
 
-int 
-XPilotDataRef::getInt()
+void
+XPilotAPIGeoIndex::reserve(int n)
 {
-    if (needsInit()) FindDataRef();
-    return XPLMGetDatai(dataRef);
+    vCellOf.reserve(size_t(n));
+    vNext.reserve(size_t(n));
+    vPrev.reserve(size_t(n));
 }
 
-float 
-XPilotDataRef::getFloat()
+void
+XPilotAPIGeoIndex::push_back()
 {
-    if (needsInit()) FindDataRef();
-    return XPLMGetDataf(dataRef);
+    vCellOf.push_back(NO_CELL);
+    vNext.push_back(-1);
+    vPrev.push_back(-1);
 }
 
-int 
-XPilotDataRef::getData(void* pOut, int inOffset, int inMaxBytes)
+void
+XPilotAPIGeoIndex::update(int i, double lat, double lon)
 {
-    if (needsInit()) FindDataRef();
-    return XPLMGetDatab(dataRef, pOut, inOffset, inMaxBytes);
+    const int cell = cellId(rowOf(lat), colOf(lon));
+    if (cell == vCellOf[size_t(i)])
+        return;
+
+    removeFromCell(i);
+    // insert at the head of the cell's list
+    const int head = vHead[size_t(cell)];
+    vCellOf[size_t(i)] = cell;
+    vPrev[size_t(i)] = -1;
+    vNext[size_t(i)] = head;
+    if (head >= 0)
+        vPrev[size_t(head)] = i;
+    vHead[size_t(cell)] = i;
 }
 
-void 
-XPilotDataRef::set(int i)
+void
+XPilotAPIGeoIndex::removeFromCell(int i)
 {
-    if (needsInit()) FindDataRef();
-    XPLMSetDatai(dataRef, i);
+    const int cell = vCellOf[size_t(i)];
+    if (cell == NO_CELL)
+        return;
+
+    const int prev = vPrev[size_t(i)];
+    const int next = vNext[size_t(i)];
+    if (prev >= 0)
+        vNext[size_t(prev)] = next;
+    else
+        vHead[size_t(cell)] = next;
+    if (next >= 0)
+        vPrev[size_t(next)] = prev;
+
+    vCellOf[size_t(i)] = NO_CELL;
+    vNext[size_t(i)] = vPrev[size_t(i)] = -1;
 }
 
-void 
-XPilotDataRef::set(float f)
+void
+XPilotAPIGeoIndex::eraseAt(int i)
 {
-    if (needsInit()) FindDataRef();
-    XPLMSetDataf(dataRef, f);
-}
\ No newline at end of file
+    removeFromCell(i);
+
+    // move the last entry into index `i`, fixing the links pointing to it
+    const int last = size() - 1;
+    if (i != last) {
+        const int cell = vCellOf[size_t(last)];
+        const int prev = vPrev[size_t(last)];
+        const int next = vNext[size_t(last)];
+        if (cell != NO_CELL) {
+            if (prev >= 0)
+                vNext[size_t(prev)] = i;
+            else
+                vHead[size_t(cell)] = i;
+            if (next >= 0)
+                vPrev[size_t(next)] = i;
+        }
+        vCellOf[size_t(i)] = cell;
+        vPrev[size_t(i)] = prev;
+        vNext[size_t(i)] = next;
+    }
+    vCellOf.pop_back();
+    vNext.pop_back();
+    vPrev.pop_back();
+}
+
+void
+XPilotAPIGeoIndex::clear()
+{
+    for (int cell : vCellOf)
+        if (cell != NO_CELL)
+            vHead[size_t(cell)] = -1;
+    vCellOf.clear();
+    vNext.clear();
+    vPrev.clear();
+}
+
+template <class F>
+void
+XPilotAPIGeoIndex::forEachInCell(int row, int col, F f) const
+{
+    col %= numCols;
+    if (col < 0) col += numCols;
+    for (int idx = vHead[size_t(cellId(row, col))]; idx >= 0; idx = vNext[size_t(idx)])
+        f(idx);
+}
+
+template <class F>
+void
+XPilotAPIGeoIndex::forEachInBox(double latMin, double latMax, double lonMin, double lonMax, F f) const
+{
+    const int rowMin = rowOf(latMin);
+    const int rowMax = rowOf(latMax);
+    const int colMin = colOf(lonMin);
+    int colMax = colOf(lonMax);
+    // box crossing the antimeridian, or covering all longitudes
+    if (colMax < colMin || lonMax - lonMin >= 360.0)
+        colMax += numCols;
+    if (lonMax - lonMin >= 360.0 || colMax - colMin >= numCols)
+        colMax = colMin + numCols - 1;
+
+    for (int row = rowMin; row <= rowMax; row++)
+        for (int col = colMin; col <= colMax; col++)
+            forEachInCell(row, col, f);
+}
+
+template <class F>
+bool
+XPilotAPIGeoIndex::forEachInRing(double lat, double lon, int ring, F f) const
+{
+    const int row0 = rowOf(lat);
+    const int col0 = colOf(lon);
+    // Columns wrap around, so no column is more than numCols/2 away.
+    // Beyond that, and with all rows covered, there's nothing left.
+    if (row0 - ring < 0 && row0 + ring >= numRows && 2 * ring > numCols)
+        return false;
+
+    // columns covered by this ring, limited to not visit any column twice
+    const int colSpan = std::min(2 * ring + 1, numCols);
+    const int colMin = col0 - ring;
+    const int colMax = colMin + colSpan - 1;
+
+    for (int row = row0 - ring; row <= row0 + ring; row++)
+    {
+        if (row < 0 || row >= numRows)
+            continue;
+        if (row == row0 - ring || row == row0 + ring) {
+            // top and bottom row: all columns
+            for (int col = colMin; col <= colMax; col++)
+                forEachInCell(row, col, f);
+        }
+        else if (2 * ring + 1 <= numCols) {
+            // rows in between: only left and right edge
+            forEachInCell(row, col0 - ring, f);
+            if (ring > 0)
+                forEachInCell(row, col0 + ring, f);
+        }
+        else if (2 * ring == numCols) {
+            // left and right edge are the same column, opposite of `col0`
+            forEachInCell(row, col0 + ring, f);
+        }
+    }
+    return true;
+}
+
+//
+// MARK: XPilotAPIFramePublisher
+//
+
+// Increments the reader count of the current slot, then verifies
+// that the slot is still current. Otherwise the writer might already
+// be refilling it, so the reader backs off and tries again.
+XPilotAPIFramePublisher::Handle
+XPilotAPIFramePublisher::acquire() const
+{
+    for (;;)
+    {
+        SlotTy* pSlot = pCurrent.load();
+        if (!pSlot)
+            return Handle();
+        pSlot->readers++;
+        if (pCurrent.load() == pSlot)
+            return Handle(pSlot);
+        pSlot->readers--;
+    }
+}
+
+XPilotAPIFleetFrame&
+XPilotAPIFramePublisher::beginWrite()
+{
+    // find a slot which is neither current nor read by anyone
+    SlotTy* const pCur = pCurrent.load();
+    pWriting = nullptr;
+    for (const std::unique_ptr<SlotTy>& pSlot : vSlots) {
+        if (pSlot.get() != pCur && pSlot->readers.load() == 0) {
+            pWriting = pSlot.get();
+            break;
+        }
+    }
+    if (!pWriting) {
+        vSlots.emplace_back(new SlotTy());
+        pWriting = vSlots.back().get();
+    }
+    return pWriting->frame;
+}
+
+void
+XPilotAPIFramePublisher::publish()
+{
+    assert(pWriting);
+    pCurrent.store(pWriting);
+    pWriting = nullptr;
+}
+
+//
+// MARK: XPilotAPIHistogram
+//
+
+void
+XPilotAPIHistogram::add(double us)
+{
+    int i = 0;
+    for (double limit = 1.0; i < NUM_BUCKETS - 1 && us >= limit; limit *= 2.0)
+        i++;
+    buckets[size_t(i)]++;
+    count++;
+    sum_us += us;
+    if (us > max_us)
+        max_us = us;
+}
+
+double
+XPilotAPIHistogram::getPercentile(double p) const
+{
+    if (!count)
+        return 0.0;
+    const uint64_t target = uint64_t(std::ceil(p * double(count)));
+    uint64_t sum = 0;
+    for (int i = 0; i < NUM_BUCKETS - 1; i++) {
+        sum += buckets[size_t(i)];
+        if (sum >= target)
+            return std::min(getBucketLimit(i), max_us);
+    }
+    return max_us;
+}
+
+double
+XPilotAPIHistogram::getBucketLimit(int i)
+{
+    return i >= NUM_BUCKETS - 1 ? std::numeric_limits<double>::infinity() : std::ldexp(1.0, i);
+}
+
+//
+// MARK: XPilotAPIStats
+//
+
+const char*
+XPilotAPIStats::getPhaseName(int ph)
+{
+    static const char* NAMES[NUM_PHASES] = { "avail", "quick", "expensive", "removal", "total" };
+    return ph >= 0 && ph < NUM_PHASES ? NAMES[ph] : "";
+}
+
+// Instrumentation of the update, compiles to nothing without XPILOTAPI_STATS
+#ifdef XPILOTAPI_STATS
+
+// Adds the time since construction to a histogram when stopped or destroyed
+class XPilotAPIStatTimer
+{
+    XPilotAPIHistogram* pHist;
+    std::chrono::steady_clock::time_point t0;
+public:
+    explicit XPilotAPIStatTimer(XPilotAPIHistogram& hist) :
+        pHist(&hist), t0(std::chrono::steady_clock::now()) {}
+    ~XPilotAPIStatTimer() { stop(); }
+    void stop() {
+        if (pHist) {
+            pHist->add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+            pHist = nullptr;
+        }
+    }
+};
+
+#define STAT_TIMER(name, ph)    XPilotAPIStatTimer name(stats.phase[XPilotAPIStats::ph])
+#define STAT_STOP(name)         name.stop()
+#define STAT_ADD(field, n)      (stats.field += uint64_t(n))
+#else
+#define STAT_TIMER(name, ph)
+#define STAT_STOP(name)
+#define STAT_ADD(field, n)
+#endif
+
+//
+// MARK: XPilotAPIConnect
+//
+
+XPilotAPIConnect::XPilotAPIConnect(fCreateAcObject* _pfCreateAcObject, int numBulkAc) :
+    bAutoBulkAc(numBulkAc == BULK_AC_AUTO),
+    iBulkAc(numBulkAc == BULK_AC_AUTO ? 64 : numBulkAc < 1 ? 1 : numBulkAc > 100 ? 100 : numBulkAc),
+    vBulkNum(new XPilotAPIAircraft::XPilotAPIBulkData[iBulkAc]),
+    vInfoTexts(new XPilotAPIAircraft::XPilotAPIBulkInfoTexts[iBulkAc]),
+    pfCreateAcObject(_pfCreateAcObject)
+{
+    bRecycleAc = pfCreateAcObject == XPilotAPIAircraft::CreateNewObject;
+    aMultIdxAc.fill(-1);
+    scratch.resize(iBulkAc);
+}
+
+bool 
+XPilotAPIConnect::doesXPilotControlAI()
+{
+    XPilotAPIBinding& xp = XPilotAPIBinding::get();
+    return xp.check() == XPilotAPIBinding::BOUND && xp.drAIControlled.getBool();
+}
+
+int 
+XPilotAPIConnect::getXPilotNumAc()
+{
+    XPilotAPIBinding& xp = XPilotAPIBinding::get();
+    return xp.check() == XPilotAPIBinding::BOUND ? xp.drNumAc.getInt() : 0;
+}
+
+void
+XPilotAPIConnect::ReceivePluginMessage(XPLMPluginID, int inMsg, void*)
+{
+    if (inMsg == XPLM_MSG_DATAREFS_ADDED)
+        XPilotAPIBinding::get().invalidate();
+}
+
+const XPilotAPIAcStore&
+XPilotAPIConnect::UpdateAcStore(ListXPilotAPIAircraft* plistRemovedAc)
+{
+    UpdateAcStoreBudgeted(std::chrono::steady_clock::time_point::max(), plistRemovedAc);
+    return acStore;
+}
+
+bool
+XPilotAPIConnect::UpdateAcStoreBudgeted(std::chrono::steady_clock::time_point deadline,
+                                        ListXPilotAPIAircraft* plistRemovedAc)
+{
+    STAT_TIMER(tTotal, PHASE_TOTAL);
+    bool bPassDone = false;
+    // a budgeted pass collects its changes over all its calls
+    if (!pass.bActive) {
+        RecycleRemovedAc();
+        changes.clear();
+    }
+    numFetchCalls = 0;
+    numFetchBytes = 0;
+
+    // In shared mode use another connection's frames if there is a provider,
+    // otherwise become the provider. A stalled provider stays registered,
+    // so then just fetch ourselves.
+    bool bProviderExists = false;
+    if (bShared && !sharedDR && UpdateFromShared(plistRemovedAc, bProviderExists))
+        bPassDone = true;
+    else {
+        if (bShared && !sharedDR && !bProviderExists)
+            RegisterShared();
+        bPassDone = DoFetch(deadline, plistRemovedAc);
+    }
+
+    if (pRecorder)
+        pRecorder->endFrame();
+    if (sharedDR && bPassDone)
+        SharedEnd();
+    STAT_ADD(numUpdates, 1);
+    STAT_ADD(numDatabBytes, numFetchBytes);
+    if (!bPassDone)
+        return false;
+
+    // the fleet is complete and consistent only at the end of a pass
+    if (bConflicts)
+        UpdateConflicts();
+    UpdateRefPoints();
+    for (XPilotAPIView& view : listViews)
+        view.Apply(changes, acStore);
+    if (bPublishFrames)
+        PublishFrame();
+    if (pShmExporter)
+        pShmExporter->write(acStore);
+
+    STAT_ADD(numAcCreated, changes.added.size());
+    STAT_ADD(numAcRemoved, changes.removed.size());
+    STAT_ADD(numPosUpdated, changes.posUpdated.size());
+    STAT_ADD(numTextsChanged, changes.textChanged.size());
+    STAT_STOP(tTotal);
+
+    // inform subscribers
+    if (!changes.empty()) {
+        for (const SubscriberTy& sub : vSubscribers)
+            sub.pfCb(changes, sub.refcon);
+    }
+    return true;
+}
+
+// Fetches from xPilot as far as `deadline` allows, returns if the pass is complete
+bool
+XPilotAPIConnect::DoFetch(std::chrono::steady_clock::time_point deadline,
+                          ListXPilotAPIAircraft* plistRemovedAc)
+{
+    XPilotAPIBinding& xp = XPilotAPIBinding::get();
+    XPilotDataRef& DRquick = xp.drBulkQuick;
+    XPilotDataRef& DRexpsv = xp.drBulkExpsv;
+
+    STAT_TIMER(tAvail, PHASE_AVAIL);
+    const int numAc = xp.check() == XPilotAPIBinding::BOUND ? xp.drNumAc.getInt() : 0;
+    STAT_STOP(tAvail);
+    if (pRecorder)
+        pRecorder->beginFrame(std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count(),
+                              std::max(numAc, 0));
+    if (sharedDR)
+        SharedBegin(std::max(numAc, 0));
+    if (numAc <= 0) {
+        STAT_TIMER(tRemoval, PHASE_REMOVAL);
+        RemoveAllAc(plistRemovedAc);
+        pass = PassTy();
+        return true;
+    }
+
+    if (!pass.bActive) {
+        updateSeq++;
+        numSeen = 0;
+        pass = PassTy();
+        pass.bActive = true;
+        pass.numAc = numAc;
+        if (bAutoBulkAc)
+            SizeBulkBuffers(numAc);
+    }
+    else if (numAc != pass.numAc)
+        pass.bShifted = true;
+
+    // always fetch at least one chunk so that every call makes progress
+    int numChunks = 0;
+    auto timeUp = [&]() { return numChunks > 0 && std::chrono::steady_clock::now() >= deadline; };
+
+    if (pass.offQuick < numAc) {
+        STAT_TIMER(tQuick, PHASE_QUICK);
+        if (DoBulkFetch<XPilotAPIAircraft::XPilotAPIBulkData>(numAc, DRquick, pass.offQuick, numChunks, deadline, vBulkNum))
+            pass.bNewAc = true;
+    }
+
+    if (pass.offQuick >= numAc && pass.offExpsv < 0 && !timeUp())
+    {
+        if (bStaggerExpsv) {
+            STAT_TIMER(tExpsv, PHASE_EXPSV);
+            if (DoStaggeredExpsvFetch(numAc, DRexpsv, numChunks, deadline))
+                pass.offExpsv = numAc;
+        }
+        else if (pass.bNewAc || std::chrono::steady_clock::now() - lastExpsvFetch > sPeriodExpsv) {
+            pass.offExpsv = 0;
+            lastExpsvFetch = std::chrono::steady_clock::now();
+        }
+        else
+            pass.offExpsv = numAc;
+    }
+
+    if (pass.offExpsv >= 0 && pass.offExpsv < numAc) {
+        STAT_TIMER(tExpsv, PHASE_EXPSV);
+        DoBulkFetch<XPilotAPIAircraft::XPilotAPIBulkInfoTexts>(numAc, DRexpsv, pass.offExpsv, numChunks, deadline, vInfoTexts);
+    }
+
+    if (pass.offQuick < numAc || pass.offExpsv < numAc)
+        return false;
+
+    STAT_TIMER(tRemoval, PHASE_REMOVAL);
+    RemoveUnseenAc(plistRemovedAc, pass.bShifted);
+    pass.bActive = false;
+    return true;
+}
+
+// Removes aircraft which didn't get updated in this pass,
+// walking backwards as RemoveAcAt() moves the last aircraft forward.
+// Nothing to do if all aircraft have been seen.
+// If xPilot's array changed size during the pass then aircraft might have
+// moved past our offset unseen, so only remove those also missed in the previous pass.
+void
+XPilotAPIConnect::RemoveUnseenAc(ListXPilotAPIAircraft* plistRemovedAc, bool bShifted)
+{
+    for (int i = acStore.size() - 1; numSeen < acStore.size() && i >= 0; i--)
+    {
+        const uint32_t seen = vAcSeq[size_t(i)].seen;
+        if (seen != updateSeq && (!bShifted || seen + 1 < updateSeq))
+            RemoveAcAt(i, plistRemovedAc);
+    }
+}
+
+const MapXPilotAPIAircraft&
+XPilotAPIConnect::UpdateAcList(ListXPilotAPIAircraft* plistRemovedAc)
+{
+    UpdateAcStore(plistRemovedAc);
+    return getAcMap();
+}
+
+// Builds the compatibility map from the store on first use (or after RemoveAllAc),
+// later updates maintain it along with the store
+const MapXPilotAPIAircraft&
+XPilotAPIConnect::getAcMap() const
+{
+    if (bMapDirty || !bMapUsed) {
+        mapAc.clear();
+        for (const SPtrXPilotAPIAircraft& pAc : acStore)
+            mapAc.emplace(pAc->getKey(), pAc);
+        bMapDirty = false;
+        bMapUsed = true;
+    }
+    return mapAc;
+}
+
+// Adds aircraft `idx` to the compatibility map, reusing a pooled map node
+void
+XPilotAPIConnect::MapInsert(int idx)
+{
+    if (!bMapUsed || bMapDirty)
+        return;
+    if (vMapNodePool.empty()) {
+        mapAc.emplace(XPilotAPI::hexStr(acStore.keyAt(idx)), acStore[idx]);
+        return;
+    }
+    MapXPilotAPIAircraft::node_type node = std::move(vMapNodePool.back());
+    vMapNodePool.pop_back();
+    node.key() = XPilotAPI::hexStr(acStore.keyAt(idx));    // short enough not to allocate
+    node.mapped() = acStore[idx];
+    mapAc.insert(std::move(node));
+}
+
+// Removes aircraft `idx` from the compatibility map, keeping the map node for reuse
+void
+XPilotAPIConnect::MapErase(int idx)
+{
+    if (!bMapUsed || bMapDirty)
+        return;
+    MapXPilotAPIAircraft::node_type node = mapAc.extract(XPilotAPI::hexStr(acStore.keyAt(idx)));
+    if (node.empty())
+        return;
+    node.mapped().reset();              // don't keep the aircraft object from being recycled
+    if ((int)vMapNodePool.size() < iAcPoolMax)
+        vMapNodePool.push_back(std::move(node));
+}
+
+int
+XPilotAPIConnect::subscribeChanges(fChangeCallback* pfCb, void* refcon)
+{
+    assert(pfCb);
+    vSubscribers.push_back({ ++lastSubscriberId, pfCb, refcon });
+    return lastSubscriberId;
+}
+
+void
+XPilotAPIConnect::unsubscribeChanges(int id)
+{
+    vSubscribers.erase(std::remove_if(vSubscribers.begin(), vSubscribers.end(),
+        [id](const SubscriberTy& sub) { return sub.id == id; }),
+        vSubscribers.end());
+}
+
+// Finds an aircraft for a given multiplayer slot
+SPtrXPilotAPIAircraft 
+XPilotAPIConnect::getAcByMultIdx(int multiIdx) const
+{
+    if (multiIdx < 1 || multiIdx >= (int)aMultIdxAc.size()) {
+        return SPtrXPilotAPIAircraft();
+    }
+
+    const int idx = aMultIdxAc[size_t(multiIdx)];
+    return idx < 0 ? SPtrXPilotAPIAircraft() : acStore[idx];
+}
+
+int
+XPilotAPIConnect::getMultIdxByKey(uint64_t keyNum) const
+{
+    const int idx = acStore.find(keyNum);
+    return idx < 0 ? 0 : fleetSoA.multiIdx[size_t(idx)];
+}
+
+// A slot can move from one aircraft to another within one fetch:
+// The new owner takes the slot right away, the previous owner only
+// releases the slot if it still points to the previous owner.
+void
+XPilotAPIConnect::UpdateMultIdx(int idx, int oldSlot, int newSlot)
+{
+    if (oldSlot > 0 && aMultIdxAc[size_t(oldSlot)] == idx)
+        aMultIdxAc[size_t(oldSlot)] = -1;
+    if (newSlot > 0)
+        aMultIdxAc[size_t(newSlot)] = idx;
+}
+
+void
+XPilotAPIConnect::queryRadius(double lat, double lon, double radiusNm,
+                              std::vector<int>& vIdxOut,
+                              double altMinFt, double altMaxFt) const
+{
+    vIdxOut.clear();
+
+    // box around the circle; near the poles the box covers all longitudes
+    const double dLat = radiusNm / 60.0;
+    const double cosLat = std::cos(XPilotAPI::deg2rad(std::min(90.0, std::abs(lat) + dLat)));
+    const double dLon = cosLat > 0.001 ? dLat / cosLat : 360.0;
+
+    geoIndex.forEachInBox(lat - dLat, lat + dLat, lon - std::min(dLon, 180.0), lon + std::min(dLon, 180.0),
+        [&](int idx)
+    {
+        const double alt = fleetSoA.alt_ft[size_t(idx)];
+        if (alt < altMinFt || alt > altMaxFt)
+            return;
+        if (XPilotAPI::distNm(lat, lon, fleetSoA.lat[size_t(idx)], fleetSoA.lon[size_t(idx)]) <= radiusNm)
+            vIdxOut.push_back(idx);
+    });
+}
+
+void
+XPilotAPIConnect::queryBox(double latMin, double latMax, double lonMin, double lonMax,
+                           std::vector<int>& vIdxOut,
+                           double altMinFt, double altMaxFt) const
+{
+    vIdxOut.clear();
+    const bool bCrossing = lonMin > lonMax;
+    geoIndex.forEachInBox(latMin, latMax, lonMin, bCrossing ? lonMax + 360.0 : lonMax,
+        [&](int idx)
+    {
+        const double alt = fleetSoA.alt_ft[size_t(idx)];
+        const double acLat = fleetSoA.lat[size_t(idx)];
+        const double acLon = fleetSoA.lon[size_t(idx)];
+        if (alt < altMinFt || alt > altMaxFt || acLat < latMin || acLat > latMax)
+            return;
+        if (bCrossing ? (acLon < lonMin && acLon > lonMax) : (acLon < lonMin || acLon > lonMax))
+            return;
+        vIdxOut.push_back(idx);
+    });
+}
+
+// Searches rings of grid cells around the position until no closer aircraft can be found
+void
+XPilotAPIConnect::nearestK(double lat, double lon, int k, std::vector<int>& vIdxOut) const
+{
+    vIdxOut.clear();
+    if (k <= 0 || acStore.empty())
+        return;
+    k = std::min(k, acStore.size());
+
+    // max-heap of (distance, index), holding the best `k` found so far
+    std::vector<std::pair<double, int> > vBest;
+    vBest.reserve(size_t(k) + 1);
+    const double cellNm = geoIndex.getCellDeg() * 60.0;
+
+    for (int ring = 0; ; ring++)
+    {
+        if (!geoIndex.forEachInRing(lat, lon, ring, [&](int idx)
+            {
+                const double d = XPilotAPI::distNm(lat, lon, fleetSoA.lat[size_t(idx)], fleetSoA.lon[size_t(idx)]);
+                if ((int)vBest.size() < k || d < vBest.front().first) {
+                    vBest.emplace_back(d, idx);
+                    std::push_heap(vBest.begin(), vBest.end());
+                    if ((int)vBest.size() > k) {
+                        std::pop_heap(vBest.begin(), vBest.end());
+                        vBest.pop_back();
+                    }
+                }
+            }))
+            break;
+
+        // Any aircraft outside this ring is at least `ring` full cells away.
+        // In east/west direction a cell shrinks with the cosine of the latitude,
+        // 2/pi accounts for sin(x) >= 2x/pi in the great circle formula.
+        if ((int)vBest.size() == k) {
+            const double maxLat = std::min(90.0, std::abs(lat) + (ring + 1) * geoIndex.getCellDeg());
+            const double minNm = ring * cellNm *
+                std::min(1.0, std::cos(XPilotAPI::deg2rad(maxLat)) * 2.0 / XPilotAPI::PI);
+            if (minNm >= vBest.front().first)
+                break;
+        }
+    }
+
+    std::sort_heap(vBest.begin(), vBest.end());
+    for (const auto& p : vBest)
+        vIdxOut.push_back(p.second);
+}
+
+//
+// Shared mode
+//
+
+#define XPILOTAPI_SHARED_DR "xpilotapi/shared/fleet"
+
+void
+XPilotAPIConnect::setShared(bool bEnable)
+{
+    bShared = bEnable;
+    if (!bShared)
+        UnregisterShared();
+    sharedSrcDR = NULL;
+    sharedFrameSeen = 0;
+    sharedFrameLast = 0;
+}
+
+int
+XPilotAPIConnect::SharedGetDesc(void* refcon, void* outValue, int inOffset, int inMaxLength)
+{
+    const XPilotAPISharedDesc& desc = reinterpret_cast<const XPilotAPIConnect*>(refcon)->sharedDesc;
+    if (!outValue)
+        return int(sizeof(desc));
+    if (inOffset != 0 || inMaxLength < int(sizeof(desc)))
+        return 0;
+    memcpy(outValue, &desc, sizeof(desc));
+    return int(sizeof(desc));
+}
+
+void
+XPilotAPIConnect::RegisterShared()
+{
+    sharedDesc = XPilotAPISharedDesc();
+    sharedDesc.magic = XPilotAPISharedDesc::MAGIC;
+    sharedDesc.version = XPilotAPISharedDesc::VERSION;
+    sharedDesc.sizeBulk = uint32_t(sizeof(XPilotAPIAircraft::XPilotAPIBulkData));
+    sharedDesc.sizeInfo = uint32_t(sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts));
+    sharedDesc.owner = this;
+    SharedBegin(0);                     // allocates an empty region
+    SharedEnd();
+    sharedDR = XPilotAPIBackend::get().RegisterDataAccessor(XPILOTAPI_SHARED_DR, xplmType_Data,
+                                                            NULL, NULL, NULL, SharedGetDesc, this);
+}
+
+void
+XPilotAPIConnect::UnregisterShared()
+{
+    if (sharedDR)
+        XPilotAPIBackend::get().UnregisterDataAccessor(sharedDR);
+    sharedDR = NULL;
+    sharedDesc = XPilotAPISharedDesc();
+    pSharedMem.reset();
+    vSharedRetired.clear();
+}
+
+// Grows the region if needed (keeping its content), then marks it as being written
+void
+XPilotAPIConnect::SharedBegin(int numAc)
+{
+    XPilotAPISharedFleet* pOld = sharedDesc.pFleet;
+    if (!pOld || uint32_t(numAc) > pOld->capacity)
+    {
+        const uint32_t cap = std::max(uint32_t(64), uint32_t(numAc + numAc / 2));
+        std::unique_ptr<uint8_t[]> pMem(new uint8_t[XPilotAPISharedFleet::getSize(cap)]);
+        XPilotAPISharedFleet* pNew = new (pMem.get()) XPilotAPISharedFleet();
+        pNew->seq.store(0);
+        pNew->capacity = cap;
+        pNew->numAc = 0;
+        pNew->frame = 0;
+        pNew->ts = 0.0;
+        if (pOld) {
+            pNew->numAc = pOld->numAc;
+            pNew->frame = pOld->frame;
+            memcpy(pNew->bulk(), pOld->bulk(), size_t(pOld->numAc) * sizeof(XPilotAPIAircraft::XPilotAPIBulkData));
+            memcpy(pNew->info(), pOld->info(), size_t(pOld->numAc) * sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts));
+            memcpy(pNew->stamp(), pOld->stamp(), size_t(pOld->numAc) * sizeof(XPilotAPISharedStampTy));
+            vSharedRetired.push_back(std::move(pSharedMem));
+        }
+        pSharedMem = std::move(pMem);
+        sharedDesc.pFleet = pNew;
+    }
+
+    XPilotAPISharedFleet& fleet = *sharedDesc.pFleet;
+    if (!(fleet.seq.load(std::memory_order_relaxed) & 1))
+        fleet.seq.fetch_add(1, std::memory_order_acq_rel);
+    // new positions start out empty
+    for (int i = fleet.numAc; i < numAc; i++) {
+        fleet.bulk()[i] = XPilotAPIAircraft::XPilotAPIBulkData();
+        fleet.info()[i] = XPilotAPIAircraft::XPilotAPIBulkInfoTexts();
+        fleet.stamp()[i] = XPilotAPISharedStampTy();
+    }
+    fleet.numAc = numAc;
+    fleet.numAcTotal = uint32_t(numAc);
+}
+
+void
+XPilotAPIConnect::SharedAdd(int first, const XPilotAPIAircraft::XPilotAPIBulkData* pBulk, int num, int sizeXP)
+{
+    XPilotAPISharedFleet& fleet = *sharedDesc.pFleet;
+    num = std::min(num, fleet.numAc - first);
+    if (first < 0 || num <= 0)
+        return;
+    if (size_t(sizeXP) >= sizeof(*pBulk))
+        memcpy(fleet.bulk() + first, pBulk, size_t(num) * sizeof(*pBulk));
+    else {
+        // consumers must not see what's left beyond xPilot's shorter records
+        for (int i = 0; i < num; i++)
+            fleet.bulk()[first + i] = CopyRecordPrefix(pBulk[i], size_t(sizeXP));
+    }
+    for (int i = first; i < first + num; i++)
+        fleet.stamp()[i].bulk = fleet.frame + 1;
+}
+
+void
+XPilotAPIConnect::SharedAdd(int first, const XPilotAPIAircraft::XPilotAPIBulkInfoTexts* pInfo, int num, int sizeXP)
+{
+    XPilotAPISharedFleet& fleet = *sharedDesc.pFleet;
+    num = std::min(num, fleet.numAc - first);
+    if (first < 0 || num <= 0)
+        return;
+    if (size_t(sizeXP) >= sizeof(*pInfo))
+        memcpy(fleet.info() + first, pInfo, size_t(num) * sizeof(*pInfo));
+    else {
+        // consumers must not see what's left beyond xPilot's shorter records
+        for (int i = 0; i < num; i++)
+            fleet.info()[first + i] = CopyRecordPrefix(pInfo[i], size_t(sizeXP));
+    }
+    for (int i = first; i < first + num; i++)
+        fleet.stamp()[i].info = fleet.frame + 1;
+}
+
+// Only called once the provider's pass is complete.
+// Consumers read the region during their own update in X-Plane's main thread,
+// so once the frame is complete no consumer can still be using an old region.
+void
+XPilotAPIConnect::SharedEnd()
+{
+    XPilotAPISharedFleet& fleet = *sharedDesc.pFleet;
+    if (!(fleet.seq.load(std::memory_order_relaxed) & 1))
+        return;
+    fleet.frame++;
+    fleet.ts = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    fleet.seq.fetch_add(1, std::memory_order_release);
+    sharedDesc.frame = fleet.frame;
+    vSharedRetired.clear();
+}
+
+bool
+XPilotAPIConnect::UpdateFromShared(ListXPilotAPIAircraft* plistRemovedAc, bool& bProviderExists)
+{
+    XPilotAPIBackend& backend = XPilotAPIBackend::get();
+    bProviderExists = false;
+    if (!sharedSrcDR) {
+        sharedSrcDR = backend.FindDataRef(XPILOTAPI_SHARED_DR);
+        sharedFrameLast = 0;
+        tsSharedFrameLast = std::chrono::steady_clock::now();
+    }
+    if (!sharedSrcDR)
+        return false;
+
+    XPilotAPISharedDesc desc;
+    if (backend.GetDatab(sharedSrcDR, &desc, 0, int(sizeof(desc))) != int(sizeof(desc))) {
+        sharedSrcDR = NULL;             // provider gone
+        return false;
+    }
+    bProviderExists = true;
+    if (desc.magic != XPilotAPISharedDesc::MAGIC ||
+        desc.version != XPilotAPISharedDesc::VERSION ||
+        desc.sizeBulk != sizeof(XPilotAPIAircraft::XPilotAPIBulkData) ||
+        desc.sizeInfo != sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts) ||
+        desc.owner == this || !desc.pFleet)
+        return false;
+
+    // a provider which is still loaded but no longer updates, e.g. disabled
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (desc.frame != sharedFrameLast) {
+        sharedFrameLast = desc.frame;
+        tsSharedFrameLast = now;
+    }
+    else if (std::chrono::duration<double>(now - tsSharedFrameLast).count() > sharedTimeoutSec)
+        return false;
+    if (desc.frame == sharedFrameSeen)
+        return true;                    // nothing new
+
+    // consistent copy of the frame
+    XPilotAPISharedFleet& fleet = *desc.pFleet;
+    uint64_t frame = 0;
+    int numAc = 0;
+    bool bOK = false;
+    for (int attempt = 0; attempt < 4 && !bOK; attempt++) {
+        const uint32_t seq = fleet.seq.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue;
+        frame = fleet.frame;
+        numAc = std::min(fleet.numAc, int(fleet.capacity));
+        vSharedBulk.resize(size_t(std::max(numAc, 0)));
+        vSharedInfo.resize(size_t(std::max(numAc, 0)));
+        vSharedStamp.resize(size_t(std::max(numAc, 0)));
+        if (numAc > 0) {
+            memcpy(vSharedBulk.data(), fleet.bulk(), size_t(numAc) * sizeof(XPilotAPIAircraft::XPilotAPIBulkData));
+            memcpy(vSharedInfo.data(), fleet.info(), size_t(numAc) * sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts));
+            memcpy(vSharedStamp.data(), fleet.stamp(), size_t(numAc) * sizeof(XPilotAPISharedStampTy));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        bOK = fleet.seq.load(std::memory_order_relaxed) == seq;
+    }
+    if (!bOK)
+        return true;                    // try again next time
+    const uint64_t frameSeen = sharedFrameSeen;
+    sharedFrameSeen = frame;
+
+    if (numAc <= 0) {
+        RemoveAllAc(plistRemovedAc);
+        pass = PassTy();
+        return true;
+    }
+
+    updateSeq++;
+    numSeen = 0;
+    pass = PassTy();
+    tsChunk = std::chrono::steady_clock::now();
+    // Positions not written in this frame hold records of earlier frames, maybe of
+    // aircraft gone meanwhile. Texts written since our last frame are only used while
+    // the aircraft is still at that position, otherwise a newer text exists elsewhere.
+    auto processRuns = [&](const auto* pRecs, auto isCurrent) {
+        const int sizeRec = int(sizeof(*pRecs));
+        for (int first = 0; first < numAc;) {
+            if (!isCurrent(size_t(first))) {
+                first++;
+                continue;
+            }
+            int num = 1;
+            while (num < iBulkAc && first + num < numAc && isCurrent(size_t(first + num)))
+                num++;
+            ProcessChunk(pRecs + first, num, first, sizeRec);
+            first += num;
+        }
+    };
+    processRuns(vSharedBulk.data(), [&](size_t i) { return vSharedStamp[i].bulk == frame; });
+    processRuns(vSharedInfo.data(), [&](size_t i) {
+        return vSharedStamp[i].bulk == frame && vSharedStamp[i].info > frameSeen &&
+               vSharedInfo[i].keyNum == vSharedBulk[i].keyNum;
+    });
+    vNewAcPos.clear();
+    RemoveUnseenAc(plistRemovedAc, false);
+    return true;
+}
+
+int
+XPilotAPIConnect::addRefPoint(double lat, double lon)
+{
+    listRefPoints.emplace_back();
+    XPilotAPIRefPoint& ref = listRefPoints.back();
+    ref.id = ++lastRefPointId;
+    ref.lat = lat;
+    ref.lon = lon;
+    ref.dist_nm.resize(size_t(acStore.size()));
+    ref.bearing.resize(size_t(acStore.size()));
+    vRefChanged.resize(size_t(acStore.size()));
+    std::iota(vRefChanged.begin(), vRefChanged.end(), 0);
+    UpdateRefPoint(ref);
+    return ref.id;
+}
+
+bool
+XPilotAPIConnect::moveRefPoint(int id, double lat, double lon)
+{
+    for (XPilotAPIRefPoint& ref : listRefPoints) {
+        if (ref.id == id) {
+            ref.lat = lat;
+            ref.lon = lon;
+            vRefChanged.resize(size_t(acStore.size()));
+            std::iota(vRefChanged.begin(), vRefChanged.end(), 0);
+            UpdateRefPoint(ref);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+XPilotAPIConnect::removeRefPoint(int id)
+{
+    listRefPoints.remove_if([id](const XPilotAPIRefPoint& ref) { return ref.id == id; });
+}
+
+const XPilotAPIRefPoint*
+XPilotAPIConnect::getRefPoint(int id) const
+{
+    for (const XPilotAPIRefPoint& ref : listRefPoints)
+        if (ref.id == id)
+            return &ref;
+    return nullptr;
+}
+
+int
+XPilotAPIConnect::addView(const XPilotAPIQuery& query)
+{
+    listViews.emplace_back(++lastViewId, query);
+    XPilotAPIView& view = listViews.back();
+    view.Rebuild(acStore);
+    return view.getId();
+}
+
+void
+XPilotAPIConnect::removeView(int id)
+{
+    listViews.remove_if([id](const XPilotAPIView& view) { return view.getId() == id; });
+}
+
+const XPilotAPIView*
+XPilotAPIConnect::getView(int id) const
+{
+    for (const XPilotAPIView& view : listViews)
+        if (view.getId() == id)
+            return &view;
+    return nullptr;
+}
+
+// Only aircraft added or moved need recomputing: AddAc() and RemoveAcAt()
+// keep the arrays of all reference points aligned with the store.
+void
+XPilotAPIConnect::UpdateRefPoints()
+{
+    if (listRefPoints.empty())
+        return;
+    vRefChanged.clear();
+    for (const XPilotAPIAcEvent& ev : changes.added) {
+        const int idx = acStore.find(ev.keyNum);
+        if (idx >= 0) vRefChanged.push_back(idx);
+    }
+    for (const XPilotAPIAcEvent& ev : changes.posUpdated) {
+        const int idx = (ev.dirty & XPilotAPIAircraft::DIRTY_POS) ? acStore.find(ev.keyNum) : -1;
+        if (idx >= 0) vRefChanged.push_back(idx);
+    }
+    if (vRefChanged.empty())
+        return;
+    for (XPilotAPIRefPoint& ref : listRefPoints)
+        UpdateRefPoint(ref);
+}
+
+// Changed aircraft are computed in one loop without branches over contiguous arrays.
+void
+XPilotAPIConnect::UpdateRefPoint(XPilotAPIRefPoint& ref)
+{
+    if (vRefChanged.empty())
+        return;
+
+    constexpr double RAD = XPilotAPI::PI / 180.0;
+    const double lat1 = ref.lat * RAD;
+    const double lon1 = ref.lon * RAD;
+    const double sinLat1 = std::sin(lat1);
+    const double cosLat1 = std::cos(lat1);
+    const size_t numChg = vRefChanged.size();
+    vRefLat.resize(numChg);
+    vRefLon.resize(numChg);
+    vRefDist.resize(numChg);
+    vRefBrg.resize(numChg);
+    for (size_t k = 0; k < numChg; k++) {
+        const size_t i = size_t(vRefChanged[k]);
+        vRefLat[k] = fleetSoA.lat[i];
+        vRefLon[k] = fleetSoA.lon[i];
+    }
+
+    const double* pLat = vRefLat.data();
+    const double* pLon = vRefLon.data();
+    float* pDist = vRefDist.data();
+    float* pBrg = vRefBrg.data();
+    for (size_t k = 0; k < numChg; k++)
+    {
+        const double lat2 = pLat[k] * RAD;
+        const double dLon = pLon[k] * RAD - lon1;
+        const double sinLat2 = std::sin(lat2);
+        const double cosLat2 = std::cos(lat2);
+        const double sinDLon = std::sin(dLon);
+        const double cosDLon = std::cos(dLon);
+        const double sHalfLat = std::sin((lat2 - lat1) / 2.0);
+        const double sHalfLon = std::sin(dLon / 2.0);
+        const double h = sHalfLat * sHalfLat + cosLat1 * cosLat2 * sHalfLon * sHalfLon;
+        pDist[k] = float(2.0 * XPilotAPI::EARTH_RADIUS_NM * std::asin(std::sqrt(std::min(h, 1.0))));
+        const double brg = std::atan2(sinDLon * cosLat2, cosLat1 * sinLat2 - sinLat1 * cosLat2 * cosDLon) / RAD;
+        pBrg[k] = float(brg < 0.0 ? brg + 360.0 : brg);
+    }
+
+    for (size_t k = 0; k < numChg; k++) {
+        const size_t i = size_t(vRefChanged[k]);
+        ref.dist_nm[i] = pDist[k];
+        ref.bearing[i] = pBrg[k];
+    }
+}
+
+void
+XPilotAPIConnect::enableConflicts(double horizNm, double vertFt)
+{
+    bConflicts = true;
+    conflictHorizNm = horizNm;
+    conflictVertFt = vertFt;
+    vConflicts.clear();
+    bConflictsRebuild = true;
+    UpdateConflicts();
+}
+
+void
+XPilotAPIConnect::disableConflicts()
+{
+    bConflicts = false;
+    vConflicts.clear();
+}
+
+// Pairs with both aircraft unchanged stay as they are.
+// Pairs involving a moved or removed aircraft are dropped,
+// then moved aircraft search their surroundings for partners again.
+void
+XPilotAPIConnect::UpdateConflicts()
+{
+    ConflictScratchTy& sc = conflictScratch;
+    const size_t numAc = size_t(acStore.size());
+    sc.vMoved.assign(numAc, bConflictsRebuild ? 1 : 0);
+    if (!bConflictsRebuild) {
+        constexpr uint32_t MOTION = XPilotAPIAircraft::DIRTY_POS | XPilotAPIAircraft::DIRTY_ATTITUDE | XPilotAPIAircraft::DIRTY_SPEED;
+        for (const XPilotAPIAcEvent& ev : changes.added) {
+            const int idx = acStore.find(ev.keyNum);
+            if (idx >= 0) sc.vMoved[size_t(idx)] = 1;
+        }
+        for (const XPilotAPIAcEvent& ev : changes.posUpdated) {
+            const int idx = (ev.dirty & MOTION) ? acStore.find(ev.keyNum) : -1;
+            if (idx >= 0) sc.vMoved[size_t(idx)] = 1;
+        }
+    }
+    bConflictsRebuild = false;
+
+    // drop pairs of removed or moved aircraft
+    vConflicts.erase(std::remove_if(vConflicts.begin(), vConflicts.end(),
+        [&](const XPilotAPIConflict& c)
+    {
+        const int a = acStore.find(c.keyA);
+        const int b = acStore.find(c.keyB);
+        return a < 0 || b < 0 || sc.vMoved[size_t(a)] || sc.vMoved[size_t(b)];
+    }), vConflicts.end());
+
+    sc.vMovedIdx.clear();
+    for (size_t i = 0; i < numAc; i++)
+        if (sc.vMoved[i])
+            sc.vMovedIdx.push_back(int(i));
+
+    // search partners in the box around each moved aircraft,
+    // pairs of two moved aircraft are only handled once
+    for (const int a : sc.vMovedIdx)
+    {
+        const double lat = fleetSoA.lat[size_t(a)];
+        const double lon = fleetSoA.lon[size_t(a)];
+        const double dLat = conflictHorizNm / 60.0;
+        const double cosLat = std::cos(XPilotAPI::deg2rad(std::min(90.0, std::abs(lat) + dLat)));
+        const double dLon = cosLat > 0.001 ? std::min(dLat / cosLat, 180.0) : 180.0;
+        const uint64_t keyA = acStore.keyAt(a);
+
+        sc.vCand.clear();
+        geoIndex.forEachInBox(lat - dLat, lat + dLat, lon - dLon, lon + dLon,
+            [&](int b)
+        {
+            if (b != a && (!sc.vMoved[size_t(b)] || keyA < acStore.keyAt(b)))
+                sc.vCand.push_back(b);
+        });
+        if (!sc.vCand.empty())
+            FindConflicts(a);
+    }
+}
+
+// Gathers the candidates into contiguous arrays, computes distance, vertical
+// separation and closest point of approach in one loop without branches
+// (for the compiler to vectorize), then keeps the pairs within the thresholds.
+void
+XPilotAPIConnect::FindConflicts(int a)
+{
+    ConflictScratchTy& sc = conflictScratch;
+    const size_t n = sc.vCand.size();
+    for (auto* pV : { &sc.lat, &sc.lon })
+        pV->resize(n);
+    for (auto* pV : { &sc.alt, &sc.trk, &sc.spd, &sc.dist, &sc.vsep, &sc.tcpa, &sc.dcpa })
+        pV->resize(n);
+    for (size_t i = 0; i < n; i++) {
+        const size_t b = size_t(sc.vCand[i]);
+        sc.lat[i] = fleetSoA.lat[b];
+        sc.lon[i] = fleetSoA.lon[b];
+        sc.alt[i] = float(fleetSoA.alt_ft[b]);
+        sc.trk[i] = fleetSoA.track[b];
+        sc.spd[i] = fleetSoA.speed_kt[b];
+    }
+
+    constexpr double RAD = XPilotAPI::PI / 180.0;
+    const size_t ai = size_t(a);
+    const double latA = fleetSoA.lat[ai] * RAD;
+    const double lonA = fleetSoA.lon[ai] * RAD;
+    const double cosLatA = std::cos(latA);
+    const float altA = float(fleetSoA.alt_ft[ai]);
+    // velocity of `a` in nm/s, east and north
+    const float vxA = float(fleetSoA.speed_kt[ai] / 3600.0 * std::sin(fleetSoA.track[ai] * RAD));
+    const float vyA = float(fleetSoA.speed_kt[ai] / 3600.0 * std::cos(fleetSoA.track[ai] * RAD));
+
+    const double* lat = sc.lat.data();
+    const double* lon = sc.lon.data();
+    const float* alt = sc.alt.data();
+    const float* trk = sc.trk.data();
+    const float* spd = sc.spd.data();
+    float* dist = sc.dist.data();
+    float* vsep = sc.vsep.data();
+    float* tcpa = sc.tcpa.data();
+    float* dcpa = sc.dcpa.data();
+    for (size_t i = 0; i < n; i++)
+    {
+        // great circle distance (haversine)
+        const double latB = lat[i] * RAD;
+        const double dLat = latB - latA;
+        double dLon = lon[i] * RAD - lonA;
+        dLon -= 2.0 * XPilotAPI::PI * std::floor(dLon / (2.0 * XPilotAPI::PI) + 0.5);
+        const double sLat = std::sin(dLat / 2.0);
+        const double sLon = std::sin(dLon / 2.0);
+        const double h = sLat * sLat + cosLatA * std::cos(latB) * sLon * sLon;
+        dist[i] = float(2.0 * XPilotAPI::EARTH_RADIUS_NM * std::asin(std::sqrt(std::min(h, 1.0))));
+        vsep[i] = std::abs(alt[i] - altA);
+
+        // closest point of approach in a local flat frame around `a`
+        const float rx = float(dLon * cosLatA * XPilotAPI::EARTH_RADIUS_NM);
+        const float ry = float(dLat * XPilotAPI::EARTH_RADIUS_NM);
+        const float vx = spd[i] / 3600.0f * std::sin(trk[i] * float(RAD)) - vxA;
+        const float vy = spd[i] / 3600.0f * std::cos(trk[i] * float(RAD)) - vyA;
+        const float vv = vx * vx + vy * vy;
+        const float t = vv > 1e-12f ? std::max(-(rx * vx + ry * vy) / vv, 0.0f) : 0.0f;
+        tcpa[i] = t;
+        const float cx = rx + vx * t;
+        const float cy = ry + vy * t;
+        dcpa[i] = std::sqrt(cx * cx + cy * cy);
+    }
+
+    const uint64_t keyA = acStore.keyAt(a);
+    for (size_t i = 0; i < n; i++) {
+        if (dist[i] > conflictHorizNm || vsep[i] > conflictVertFt)
+            continue;
+        const uint64_t keyB = acStore.keyAt(sc.vCand[i]);
+        vConflicts.push_back({ std::min(keyA, keyB), std::max(keyA, keyB),
+                               dist[i], vsep[i], tcpa[i], dcpa[i] });
+    }
+}
+
+void
+XPilotAPIConnect::PublishFrame()
+{
+    XPilotAPIFleetFrame& frame = framePublisher.beginWrite();
+    frame.updateSeq = updateSeq;
+    frame.ts = std::chrono::steady_clock::now();
+    frame.vBulk.resize(size_t(acStore.size()));
+    frame.vInfo.resize(size_t(acStore.size()));
+    for (int i = 0; i < acStore.size(); i++) {
+        frame.vBulk[size_t(i)] = acStore[i]->getBulk();
+        frame.vInfo[size_t(i)] = acStore[i]->getInfo();
+        frame.vInfo[size_t(i)].keyNum = acStore.keyAt(i);  // in case texts didn't arrive yet
+    }
+    framePublisher.publish();
+}
+
+void
+XPilotAPIConnect::setHistoryCapacity(int n)
+{
+    historyCapacity = std::max(0, n);
+    for (const SPtrXPilotAPIAircraft& pAc : acStore)
+        pAc->setHistoryCapacity(historyCapacity);
+    for (const SPtrXPilotAPIAircraft& pAc : vAcPool)
+        pAc->setHistoryCapacity(historyCapacity);
+}
+
+void
+XPilotAPIConnect::reserveAc(int n)
+{
+    acStore.reserve(n);
+    fleetSoA.reserve(n);
+    geoIndex.reserve(n);
+    vAcSeq.reserve(size_t(n));
+    vMapNodePool.reserve(size_t(std::min(n, iAcPoolMax)));
+    changes.added.reserve(size_t(n));
+    changes.removed.reserve(size_t(n));
+    changes.posUpdated.reserve(size_t(n));
+    changes.textChanged.reserve(size_t(n));
+    changes.vRemovedAc.reserve(size_t(n));
+
+    // pre-create objects for reuse
+    if (bRecycleAc) {
+        assert(pfCreateAcObject);
+        const int numPool = std::min(n, iAcPoolMax);
+        vAcPool.reserve(size_t(numPool));
+        while ((int)vAcPool.size() < numPool)
+            vAcPool.emplace_back(pfCreateAcObject());
+    }
+}
+
+void
+XPilotAPIConnect::RecycleRemovedAc()
+{
+    if (!bRecycleAc || changes.vRemovedAc.empty())
+        return;
+
+    // after RemoveAllAc the compatibility map still holds removed objects, it needs rebuilding anyway
+    if (bMapDirty)
+        mapAc.clear();
+
+    for (SPtrXPilotAPIAircraft& pAc : changes.vRemovedAc) {
+        if (pAc.use_count() == 1 && (int)vAcPool.size() < iAcPoolMax) {
+            pAc->recycle();
+            vAcPool.emplace_back(std::move(pAc));
+        }
+    }
+}
+
+// Creates a new aircraft object (or reuses one from the pool)
+// and adds it to the store and all per-aircraft arrays
+int
+XPilotAPIConnect::AddAc(uint64_t keyNum)
+{
+    SPtrXPilotAPIAircraft pAc;
+    if (!vAcPool.empty()) {
+        pAc = std::move(vAcPool.back());
+        vAcPool.pop_back();
+    }
+    else {
+        assert(pfCreateAcObject);
+        pAc.reset(pfCreateAcObject());
+    }
+    pAc->setHistoryCapacity(historyCapacity);
+    const int idx = acStore.insert(keyNum, std::move(pAc));
+    fleetSoA.push_back(keyNum);
+    geoIndex.push_back();
+    vAcSeq.emplace_back();
+    vAcSeq.back().added = updateSeq;
+    for (XPilotAPIRefPoint& ref : listRefPoints) {   // computed at the end of the update
+        ref.dist_nm.push_back(0.0f);
+        ref.bearing.push_back(0.0f);
+    }
+    changes.added.push_back({ acStore[idx].get(), keyNum, XPilotAPIAircraft::DIRTY_ALL });
+    assert(fleetSoA.size() == acStore.size());
+    assert(geoIndex.size() == acStore.size());
+    MapInsert(idx);
+    return idx;
+}
+
+void
+XPilotAPIConnect::RemoveAcAt(int i, ListXPilotAPIAircraft* plistRemovedAc)
+{
+    if (plistRemovedAc) {
+        plistRemovedAc->push_back(acStore[i]);
+    }
+    changes.removed.push_back({ acStore[i].get(), acStore.keyAt(i), XPilotAPIAircraft::DIRTY_ALL });
+    changes.vRemovedAc.push_back(acStore[i]);
+    MapErase(i);
+    // release the slot of the removed aircraft, re-point the slot of the aircraft moving into index `i`
+    const int last = acStore.size() - 1;
+    UpdateMultIdx(i, fleetSoA.multiIdx[size_t(i)], 0);
+    const int lastSlot = fleetSoA.multiIdx[size_t(last)];
+    if (i != last && lastSlot > 0 && aMultIdxAc[size_t(lastSlot)] == last)
+        aMultIdxAc[size_t(lastSlot)] = i;
+
+    acStore.eraseAt(i);
+    fleetSoA.eraseAt(i);
+    geoIndex.eraseAt(i);
+    SwapPop(vAcSeq, size_t(i));
+    for (XPilotAPIRefPoint& ref : listRefPoints) {
+        SwapPop(ref.dist_nm, size_t(i));
+        SwapPop(ref.bearing, size_t(i));
+    }
+}
+
+void
+XPilotAPIConnect::RemoveAllAc(ListXPilotAPIAircraft* plistRemovedAc)
+{
+    if (acStore.empty())
+        return;
+    for (int i = 0; i < acStore.size(); i++) {
+        if (plistRemovedAc) {
+            plistRemovedAc->push_back(acStore[i]);
+        }
+        changes.removed.push_back({ acStore[i].get(), acStore.keyAt(i), XPilotAPIAircraft::DIRTY_ALL });
+        changes.vRemovedAc.push_back(acStore[i]);
+    }
+    acStore.clear();
+    fleetSoA.clear();
+    geoIndex.clear();
+    vAcSeq.clear();
+    for (XPilotAPIRefPoint& ref : listRefPoints) {
+        ref.dist_nm.clear();
+        ref.bearing.clear();
+    }
+    aMultIdxAc.fill(-1);
+    bMapDirty = true;
+}
+
+void
+XPilotAPIConnect::ChunkScratchTy::resize(int n)
+{
+    const size_t num = size_t(n);
+    vIdx.resize(num);
+    vNew.resize(num);
+    vRec.resize(num);
+    for (auto* pV : { &cLat, &cLon, &cAlt, &pLat, &pLon, &pAlt, &ts })
+        pV->resize(num);
+    for (auto* pV : { &cHdg, &cSpd, &pHdg, &pSpd, &vsi, &turn, &track, &accel })
+        pV->resize(num);
+}
+
+// Computes derived motion values for `n` aircraft from current values `c...`
+// and previous values `p...`. `ts`, `vsi`, `turn`, `track`, and `accel` hold the
+// previous results on entry and the new results on return.
+// One plain loop without branches or calls into the aircraft objects,
+// so that the compiler can vectorize it.
+static void ComputeKinematics(int n, double now, double tau,
+                              const double* cLat, const double* cLon, const double* cAlt,
+                              const float* cHdg, const float* cSpd,
+                              const double* pLat, const double* pLon, const double* pAlt,
+                              const float* pHdg, const float* pSpd,
+                              double* ts, float* vsi, float* turn, float* track, float* accel)
+{
+    constexpr double RAD = XPilotAPI::PI / 180.0;
+    for (int i = 0; i < n; i++)
+    {
+        const bool bInit = ts[i] <= 0.0;                // first record of this aircraft
+        const bool bChg = cLat[i] != pLat[i] || cLon[i] != pLon[i] || cAlt[i] != pAlt[i] ||
+                          cHdg[i] != pHdg[i] || cSpd[i] != pSpd[i];
+        const double dt = std::max(now - ts[i], 0.001);
+        const bool bUpd = bChg && !bInit;
+        const float a = float(dt / (tau + dt));         // smoothing factor
+
+        // raw values since the previous change
+        const float rawVsi = float((cAlt[i] - pAlt[i]) / dt * 60.0);
+        float dHdg = cHdg[i] - pHdg[i];
+        dHdg -= 360.0f * std::floor(dHdg / 360.0f + 0.5f);
+        const float rawTurn = float(dHdg / dt);
+        const float rawAccel = float((cSpd[i] - pSpd[i]) / dt);
+
+        // track from the position change, only if the aircraft actually moved
+        double dLon = cLon[i] - pLon[i];
+        dLon -= 360.0 * std::floor(dLon / 360.0 + 0.5);
+        const double dEast = dLon * std::cos(cLat[i] * RAD);
+        const double dNorth = cLat[i] - pLat[i];
+        const bool bMoved = dEast * dEast + dNorth * dNorth > 1e-12;
+        float rawTrack = float(std::atan2(dEast, dNorth) / RAD);
+        rawTrack += rawTrack < 0.0f ? 360.0f : 0.0f;
+        float dTrack = rawTrack - track[i];
+        dTrack -= 360.0f * std::floor(dTrack / 360.0f + 0.5f);
+        float newTrack = track[i] + a * dTrack;
+        newTrack += newTrack < 0.0f ? 360.0f : newTrack >= 360.0f ? -360.0f : 0.0f;
+
+        vsi[i]   = bInit ? 0.0f : bUpd ? vsi[i]   + a * (rawVsi   - vsi[i])   : vsi[i];
+        turn[i]  = bInit ? 0.0f : bUpd ? turn[i]  + a * (rawTurn  - turn[i])  : turn[i];
+        accel[i] = bInit ? 0.0f : bUpd ? accel[i] + a * (rawAccel - accel[i]) : accel[i];
+        track[i] = bInit ? cHdg[i] : bUpd && bMoved ? newTrack : track[i];
+        ts[i]    = bInit || bChg ? now : ts[i];
+    }
+}
+
+// Creates or updates the aircraft of a chunk in three passes:
+// 1. find or create aircraft, gather previous values,
+// 2. compute derived motion values for the whole chunk,
+// 3. update aircraft objects and all per-aircraft arrays.
+bool
+XPilotAPIConnect::ProcessChunk(const XPilotAPIAircraft::XPilotAPIBulkData* pBulk, int num, int first, int sizeXP)
+{
+    bool ret = false;
+    ChunkScratchTy& sc = scratch;
+
+    // records shorter than ours: only xPilot's prefix is valid, the rest is left over from earlier fetches
+    if (size_t(sizeXP) < sizeof(*pBulk)) {
+        for (int i = 0; i < num; i++)
+            sc.vRec[size_t(i)] = CopyRecordPrefix(pBulk[i], size_t(sizeXP));
+        pBulk = sc.vRec.data();
+    }
+
+    for (int i = 0; i < num; i++)
+    {
+        const XPilotAPIAircraft::XPilotAPIBulkData& bulk = pBulk[i];
+        // key 0 marks an empty record, e.g. a position not written yet
+        if (bulk.keyNum == 0) {
+            const size_t si = size_t(i);
+            sc.vIdx[si] = -1;
+            sc.vNew[si] = 0;
+            sc.cLat[si] = sc.pLat[si] = sc.cLon[si] = sc.pLon[si] = sc.cAlt[si] = sc.pAlt[si] = 0.0;
+            sc.cHdg[si] = sc.pHdg[si] = sc.cSpd[si] = sc.pSpd[si] = 0.0;
+            sc.ts[si] = sc.vsi[si] = sc.turn[si] = sc.track[si] = sc.accel[si] = 0.0;
+            continue;
+        }
+        int idx = acStore.find(bulk.keyNum);
+        sc.vNew[size_t(i)] = idx < 0;
+        if (idx < 0) {
+            idx = AddAc(bulk.keyNum);
+            ret = true;
+            if (bStaggerExpsv)
+                vNewAcPos.push_back(first + i);
+        }
+        sc.vIdx[size_t(i)] = idx;
+
+        const size_t si = size_t(i);
+        const size_t ai = size_t(idx);
+        sc.cLat[si]  = bulk.lat;                sc.pLat[si]  = fleetSoA.lat[ai];
+        sc.cLon[si]  = bulk.lon;                sc.pLon[si]  = fleetSoA.lon[ai];
+        sc.cAlt[si]  = bulk.alt_ft;             sc.pAlt[si]  = fleetSoA.alt_ft[ai];
+        sc.cHdg[si]  = bulk.heading;            sc.pHdg[si]  = fleetSoA.heading[ai];
+        sc.cSpd[si]  = bulk.speed_kt;           sc.pSpd[si]  = fleetSoA.speed_kt[ai];
+        sc.ts[si]    = fleetSoA.ts[ai];
+        sc.vsi[si]   = fleetSoA.vsi_fpm[ai];
+        sc.turn[si]  = fleetSoA.turnRate_dps[ai];
+        sc.track[si] = fleetSoA.track[ai];
+        sc.accel[si] = fleetSoA.accel_kts[ai];
+    }
+
+    const double now = std::chrono::duration<double>(tsChunk.time_since_epoch()).count();
+    ComputeKinematics(num, now, kinSmoothingSec,
+                      sc.cLat.data(), sc.cLon.data(), sc.cAlt.data(), sc.cHdg.data(), sc.cSpd.data(),
+                      sc.pLat.data(), sc.pLon.data(), sc.pAlt.data(), sc.pHdg.data(), sc.pSpd.data(),
+                      sc.ts.data(), sc.vsi.data(), sc.turn.data(), sc.track.data(), sc.accel.data());
+
+    for (int i = 0; i < num; i++)
+    {
+        const size_t si = size_t(i);
+        const int idx = sc.vIdx[si];
+        if (idx < 0)
+            continue;
+        ProcessRecord(pBulk[i], sizeXP, idx, sc.vNew[si] != 0);
+
+        XPilotAPIKinematics kin;
+        kin.vsi_fpm = sc.vsi[si];
+        kin.turnRate_dps = sc.turn[si];
+        kin.track = sc.track[si];
+        kin.accel_kts = sc.accel[si];
+        fleetSoA.set(idx, sc.ts[si], kin);
+        acStore[idx]->setKinematics(kin);
+    }
+    return ret;
+}
+
+bool
+XPilotAPIConnect::ProcessChunk(const XPilotAPIAircraft::XPilotAPIBulkInfoTexts* pInfo, int num, int, int sizeXP)
+{
+    const bool bShort = size_t(sizeXP) < sizeof(*pInfo);
+    for (int i = 0; i < num; i++) {
+        if (bShort)                     // compare only what xPilot actually wrote
+            ProcessRecord(CopyRecordPrefix(pInfo[i], size_t(sizeXP)), sizeXP);
+        else
+            ProcessRecord(pInfo[i], sizeXP);
+    }
+    return false;
+}
+
+// Updates the aircraft and all per-aircraft arrays, and records the change
+void
+XPilotAPIConnect::ProcessRecord(const XPilotAPIAircraft::XPilotAPIBulkData& bulk, int sizeXP, int idx, bool bNew)
+{
+    AcSeqTy& seq = vAcSeq[size_t(idx)];
+    if (seq.seen != updateSeq) {
+        seq.seen = updateSeq;
+        numSeen++;
+    }
+
+    XPilotAPIAircraft* pAc = acStore[idx].get();
+    pAc->updateAircraft(bulk, size_t(sizeXP));
+    // history only needs a new sample if position, heading or speed changed
+    if (historyCapacity > 0 &&
+        (bNew || pAc->getDirty() & (XPilotAPIAircraft::DIRTY_POS | XPilotAPIAircraft::DIRTY_ATTITUDE | XPilotAPIAircraft::DIRTY_SPEED)))
+        pAc->addHistorySample(tsChunk);
+    UpdateMultIdx(idx, fleetSoA.multiIdx[size_t(idx)], bulk.bits.multiIdx);
+    fleetSoA.set(idx, bulk);
+    geoIndex.update(idx, bulk.lat, bulk.lon);
+
+    // list each aircraft once per pass, even if a shifted array delivers it twice
+    const uint32_t dirty = pAc->getDirty() & XPilotAPIAircraft::DIRTY_BULK;
+    if (!bNew && dirty && seq.added != updateSeq && seq.posUpdated != updateSeq) {
+        seq.posUpdated = updateSeq;
+        changes.posUpdated.push_back({ pAc, bulk.keyNum, dirty });
+    }
+}
+
+// Updates the texts of a known aircraft and records the change
+bool
+XPilotAPIConnect::ProcessRecord(const XPilotAPIAircraft::XPilotAPIBulkInfoTexts& info, int sizeXP)
+{
+    if (info.keyNum == 0)               // empty record
+        return false;
+    const int idx = acStore.find(info.keyNum);
+    if (idx < 0)                        // appeared after the numerical fetch, handled next time
+        return false;
+
+    // only pass on texts which actually changed
+    XPilotAPIAircraft* pAc = acStore[idx].get();
+    if (pAc->getInfo().keyNum == info.keyNum && !XPilotAPIAircraft::diff(pAc->getInfo(), info))
+        return false;
+    pAc->updateAircraft(info, size_t(sizeXP));
+
+    const uint32_t dirty = pAc->getDirty() & XPilotAPIAircraft::DIRTY_TEXT;
+    if (dirty && vAcSeq[size_t(idx)].added != updateSeq)
+        changes.textChanged.push_back({ pAc, info.keyNum, dirty });
+    return false;
+}
+
+// fetch bulk data and create/update aircraft objects
+template <class T>
+bool XPilotAPIConnect::DoBulkFetch(int numAc, XPilotDataRef& DR, int& offset, int& numChunks,
+    std::chrono::steady_clock::time_point deadline,
+    std::unique_ptr<T[]>& vBulk)
+{
+    bool ret = false;
+
+    const int sizeXP = DR.getData(NULL, 0, sizeof(T));
+    STAT_ADD(numDatabCalls, 1);
+
+    for (;
+        offset < numAc && (numChunks == 0 || std::chrono::steady_clock::now() < deadline);
+        numChunks++)
+    {
+        const int num = std::min(iBulkAc, numAc - offset);
+        if (FetchChunk(DR, offset, num, sizeXP, vBulk))
+            ret = true;
+        offset += num;
+    }
+    return ret;
+}
+
+template <class T>
+bool XPilotAPIConnect::FetchChunk(XPilotDataRef& DR, int first, int num, int sizeXP,
+    std::unique_ptr<T[]>& vBulk)
+{
+    assert(num <= iBulkAc);
+
+    const int acRcvd = std::min(DR.getData(vBulk.get(),
+        first * sizeof(T),
+        num * sizeof(T)) / int(sizeof(T)),
+        num);
+    tsChunk = std::chrono::steady_clock::now();
+    numFetchCalls++;
+    STAT_ADD(numDatabCalls, 1);
+    if (pRecorder && acRcvd > 0)
+        pRecorder->addRecords(first, vBulk.get(), acRcvd);
+    if (sharedDR && acRcvd > 0)
+        SharedAdd(first, vBulk.get(), acRcvd, sizeXP);
+    // xPilot copies the smaller of its and our struct size per record
+    if (acRcvd > 0)
+        numFetchBytes += size_t(acRcvd) * std::min(size_t(sizeXP), sizeof(T));
+
+    return ProcessChunk(vBulk.get(), acRcvd, first, sizeXP);
+}
+
+// Texts of new aircraft are fetched first, consecutive positions in one call.
+// Then texts of the next `iExpsvBudgetAc` aircraft are refreshed.
+// Both resume in the next call of the pass if `deadline` passes in between.
+bool
+XPilotAPIConnect::DoStaggeredExpsvFetch(int numAc, XPilotDataRef& DR, int& numChunks,
+                                        std::chrono::steady_clock::time_point deadline)
+{
+    auto timeUp = [&]() { return numChunks > 0 && std::chrono::steady_clock::now() >= deadline; };
+    const int sizeXP = DR.getData(NULL, 0, sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts));
+    STAT_ADD(numDatabCalls, 1);
+
+    size_t n = 0;
+    for (; n < vNewAcPos.size() && !timeUp(); numChunks++)
+    {
+        const int first = vNewAcPos[n];
+        int num = 1;
+        while (n + size_t(num) < vNewAcPos.size() &&
+               vNewAcPos[n + size_t(num)] == first + num &&
+               num < iBulkAc)
+            num++;
+        FetchChunk(DR, first, num, sizeXP, vInfoTexts);
+        n += size_t(num);
+    }
+    vNewAcPos.erase(vNewAcPos.begin(), vNewAcPos.begin() + ptrdiff_t(n));
+    if (!vNewAcPos.empty())
+        return false;
+
+    if (pass.expsvBudget < 0)
+        pass.expsvBudget = std::min(iExpsvBudgetAc, numAc);
+    if (expsvOffset >= numAc)
+        expsvOffset = 0;
+    for (; pass.expsvBudget > 0 && !timeUp(); numChunks++)
+    {
+        const int num = std::min(std::min(pass.expsvBudget, iBulkAc), numAc - expsvOffset);
+        FetchChunk(DR, expsvOffset, num, sizeXP, vInfoTexts);
+        expsvOffset = (expsvOffset + num) % numAc;
+        pass.expsvBudget -= num;
+    }
+    return pass.expsvBudget == 0;
+}
+
+// Buffers only grow, with some headroom, to avoid reallocating while traffic builds up.
+// Records are stored in our struct size, xPilot copies at most that much per record.
+void
+XPilotAPIConnect::SizeBulkBuffers(int numAc)
+{
+    if (numAc <= iBulkAc || iBulkAc >= iBulkAcMax)
+        return;
+    const int num = std::min(((numAc + numAc / 4) + 63) / 64 * 64, std::max(iBulkAcMax, 1));
+    vBulkNum.reset(new XPilotAPIAircraft::XPilotAPIBulkData[size_t(num)]);
+    vInfoTexts.reset(new XPilotAPIAircraft::XPilotAPIBulkInfoTexts[size_t(num)]);
+    scratch.resize(num);
+    iBulkAc = num;
+}
+
+// Like FetchChunk(), but without processing, recording, or sharing the records.
+// Records are stored at our struct size, xPilot copies at most `sizeXP` bytes of each.
+int
+XPilotAPIConnect::FetchRawChunks(bool bTexts, fRawChunkCallback* pfCb, void* refcon)
+{
+    XPilotAPIBinding& xp = XPilotAPIBinding::get();
+    const int numAc = xp.check() == XPilotAPIBinding::BOUND ? xp.drNumAc.getInt() : 0;
+    if (numAc <= 0)
+        return 0;
+    if (bAutoBulkAc)
+        SizeBulkBuffers(numAc);
+
+    XPilotDataRef& DR = bTexts ? xp.drBulkExpsv : xp.drBulkQuick;
+    const int recSize = bTexts ? int(sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts)) :
+                                 int(sizeof(XPilotAPIAircraft::XPilotAPIBulkData));
+    void* pBuf = bTexts ? static_cast<void*>(vInfoTexts.get()) : static_cast<void*>(vBulkNum.get());
+    const int sizeXP = DR.getData(NULL, 0, recSize);
+    STAT_ADD(numDatabCalls, 1);
+    // records not even containing the key are useless
+    if (sizeXP < int(sizeof(uint64_t)))
+        return 0;
+
+    int numRcvd = 0;
+    for (int first = 0; first < numAc; first += iBulkAc)
+    {
+        const int num = std::min(iBulkAc, numAc - first);
+        const int acRcvd = std::min(DR.getData(pBuf, first * recSize, num * recSize) / recSize, num);
+        numFetchCalls++;
+        STAT_ADD(numDatabCalls, 1);
+        if (acRcvd <= 0)
+            break;
+        numFetchBytes += size_t(acRcvd) * size_t(std::min(sizeXP, recSize));
+        pfCb(pBuf, acRcvd, first, sizeXP, refcon);
+        numRcvd += acRcvd;
+        // xPilot's array shrank meanwhile
+        if (acRcvd < num)
+            break;
+    }
+    return numRcvd;
+}
+
+XPilotAPIConnect::~XPilotAPIConnect()
+{
+    unpublishStatsDataRefs();
+    UnregisterShared();
+}
+
+// Values published per phase by publishStatsDataRefs()
+enum StatsHistItemTy {
+    STAT_ITEM_MEAN = 0, STAT_ITEM_P50, STAT_ITEM_P99, STAT_ITEM_MAX, STAT_ITEM_BUCKETS,
+    STAT_NUM_HIST_ITEMS
+};
+
+// Counters published by publishStatsDataRefs()
+enum StatsCounterTy {
+    STAT_CNT_UPDATES = 0, STAT_CNT_DATAB_CALLS, STAT_CNT_DATAB_BYTES,
+    STAT_CNT_AC_CREATED, STAT_CNT_AC_REMOVED, STAT_CNT_POS_UPDATED, STAT_CNT_TEXTS_CHANGED,
+    STAT_NUM_COUNTERS
+};
+
+// Integer datarefs can't hold 64 bit counters, they stop at INT_MAX
+static int ClampToInt(uint64_t n)
+{
+    return int(std::min(n, uint64_t(std::numeric_limits<int>::max())));
+}
+
+static uint64_t StatsCounter(const XPilotAPIStats& st, int item)
+{
+    switch (item) {
+        case STAT_CNT_UPDATES:          return st.numUpdates;
+        case STAT_CNT_DATAB_CALLS:      return st.numDatabCalls;
+        case STAT_CNT_DATAB_BYTES:      return st.numDatabBytes;
+        case STAT_CNT_AC_CREATED:       return st.numAcCreated;
+        case STAT_CNT_AC_REMOVED:       return st.numAcRemoved;
+        case STAT_CNT_POS_UPDATED:      return st.numPosUpdated;
+        case STAT_CNT_TEXTS_CHANGED:    return st.numTextsChanged;
+    }
+    return 0;
+}
+
+float
+XPilotAPIConnect::StatsGetf(void* refcon)
+{
+    const auto* pDR = reinterpret_cast<const StatsDataRefTy*>(refcon);
+    if (pDR->phase < 0)
+        return float(StatsCounter(*pDR->pStats, pDR->item));
+    const XPilotAPIHistogram& hist = pDR->pStats->phase[size_t(pDR->phase)];
+    switch (pDR->item) {
+        case STAT_ITEM_MEAN:    return float(hist.getMean());
+        case STAT_ITEM_P50:     return float(hist.getPercentile(0.5));
+        case STAT_ITEM_P99:     return float(hist.getPercentile(0.99));
+        case STAT_ITEM_MAX:     return float(hist.max_us);
+    }
+    return 0.0f;
+}
+
+int
+XPilotAPIConnect::StatsGetvi(void* refcon, int* outValues, int inOffset, int inMax)
+{
+    const auto* pDR = reinterpret_cast<const StatsDataRefTy*>(refcon);
+    const XPilotAPIHistogram& hist = pDR->pStats->phase[size_t(pDR->phase)];
+    if (!outValues)
+        return XPilotAPIHistogram::NUM_BUCKETS;
+    int n = 0;
+    for (int i = inOffset; i < XPilotAPIHistogram::NUM_BUCKETS && n < inMax; i++, n++)
+        outValues[n] = ClampToInt(hist.buckets[size_t(i)]);
+    return n;
+}
+
+int
+XPilotAPIConnect::StatsGeti(void* refcon)
+{
+    const auto* pDR = reinterpret_cast<const StatsDataRefTy*>(refcon);
+    return ClampToInt(StatsCounter(*pDR->pStats, pDR->item));
+}
+
+// Without XPILOTAPI_STATS there is nothing to publish
+void
+XPilotAPIConnect::publishStatsDataRefs(const char* prefix)
+{
+    unpublishStatsDataRefs();
+#ifdef XPILOTAPI_STATS
+    static const char* HIST_ITEMS[STAT_NUM_HIST_ITEMS] = { "mean_us", "p50_us", "p99_us", "max_us", "buckets" };
+    static const char* COUNTERS[STAT_NUM_COUNTERS] = {
+        "updates", "datab_calls", "datab_bytes", "ac_created", "ac_removed", "pos_updated", "texts_changed" };
+
+    XPilotAPIBackend& backend = XPilotAPIBackend::get();
+    for (int ph = 0; ph < XPilotAPIStats::NUM_PHASES; ph++) {
+        for (int item = 0; item < STAT_NUM_HIST_ITEMS; item++) {
+            listStatsDR.push_back({ NULL, &stats, ph, item });
+            const std::string name = std::string(prefix) + '/' + XPilotAPIStats::getPhaseName(ph) + '/' + HIST_ITEMS[item];
+            listStatsDR.back().dataRef = item == STAT_ITEM_BUCKETS ?
+                backend.RegisterDataAccessor(name.c_str(), xplmType_IntArray, NULL, NULL, StatsGetvi, NULL, &listStatsDR.back()) :
+                backend.RegisterDataAccessor(name.c_str(), xplmType_Float, NULL, StatsGetf, NULL, NULL, &listStatsDR.back());
+        }
+    }
+    // counters read as int (clamped) or as float (full range, rounded)
+    for (int item = 0; item < STAT_NUM_COUNTERS; item++) {
+        listStatsDR.push_back({ NULL, &stats, -1, item });
+        const std::string name = std::string(prefix) + '/' + COUNTERS[item];
+        listStatsDR.back().dataRef =
+            backend.RegisterDataAccessor(name.c_str(), xplmType_Int | xplmType_Float,
+                                         StatsGeti, StatsGetf, NULL, NULL, &listStatsDR.back());
+    }
+#else
+    (void)prefix;
+#endif
+}
+
+void
+XPilotAPIConnect::unpublishStatsDataRefs()
+{
+    for (const StatsDataRefTy& dr : listStatsDR)
+        if (dr.dataRef)
+            XPilotAPIBackend::get().UnregisterDataAccessor(dr.dataRef);
+    listStatsDR.clear();
+}
+
+bool 
+XPilotAPIConnect::isXPilotAvail()
+{
+    return XPilotAPIBinding::get().check() == XPilotAPIBinding::BOUND;
+}
+
+//
+// MARK: XPilotAPIBackend
+//
+
+static XPilotAPIBackend gXPLMBackend;
+XPilotAPIBackend* XPilotAPIBackend::pCurr = &gXPLMBackend;
+unsigned XPilotAPIBackend::generation = 0;
+
+void
+XPilotAPIBackend::set(XPilotAPIBackend* pBackend)
+{
+    pCurr = pBackend ? pBackend : &gXPLMBackend;
+    generation++;
+}
+
+#ifndef XPILOTAPI_NO_XPLM
+
+XPLMPluginID
+XPilotAPIBackend::FindPluginBySignature(const char* inSignature)
+{ return XPLMFindPluginBySignature(inSignature); }
+
+int
+XPilotAPIBackend::IsPluginEnabled(XPLMPluginID inPluginID)
+{ return XPLMIsPluginEnabled(inPluginID); }
+
+XPLMDataRef
+XPilotAPIBackend::FindDataRef(const char* inDataRefName)
+{ return XPLMFindDataRef(inDataRefName); }
+
+XPLMDataTypeID
+XPilotAPIBackend::GetDataRefTypes(XPLMDataRef inDataRef)
+{ return XPLMGetDataRefTypes(inDataRef); }
+
+int
+XPilotAPIBackend::GetDatai(XPLMDataRef inDataRef)
+{ return XPLMGetDatai(inDataRef); }
+
+float
+XPilotAPIBackend::GetDataf(XPLMDataRef inDataRef)
+{ return XPLMGetDataf(inDataRef); }
+
+int
+XPilotAPIBackend::GetDatab(XPLMDataRef inDataRef, void* outValue, int inOffset, int inMaxBytes)
+{ return XPLMGetDatab(inDataRef, outValue, inOffset, inMaxBytes); }
+
+void
+XPilotAPIBackend::SetDatai(XPLMDataRef inDataRef, int inValue)
+{ XPLMSetDatai(inDataRef, inValue); }
+
+void
+XPilotAPIBackend::SetDataf(XPLMDataRef inDataRef, float inValue)
+{ XPLMSetDataf(inDataRef, inValue); }
+
+XPLMDataRef
+XPilotAPIBackend::RegisterDataAccessor(const char* inDataName, XPLMDataTypeID inDataType,
+                                       XPLMGetDatai_f inReadInt, XPLMGetDataf_f inReadFloat,
+                                       XPLMGetDatavi_f inReadIntArray, XPLMGetDatab_f inReadData,
+                                       void* inRefcon)
+{
+    return XPLMRegisterDataAccessor(inDataName, inDataType, 0,
+                                    inReadInt, NULL, inReadFloat, NULL,
+                                    NULL, NULL, inReadIntArray, NULL,
+                                    NULL, NULL, inReadData, NULL,
+                                    inRefcon, NULL);
+}
+
+void
+XPilotAPIBackend::UnregisterDataAccessor(XPLMDataRef inDataRef)
+{ XPLMUnregisterDataAccessor(inDataRef); }
+
+#else // XPILOTAPI_NO_XPLM
+
+XPLMPluginID XPilotAPIBackend::FindPluginBySignature(const char*) { return XPLM_NO_PLUGIN_ID; }
+int XPilotAPIBackend::IsPluginEnabled(XPLMPluginID) { return 0; }
+XPLMDataRef XPilotAPIBackend::FindDataRef(const char*) { return NULL; }
+XPLMDataTypeID XPilotAPIBackend::GetDataRefTypes(XPLMDataRef) { return xplmType_Unknown; }
+int XPilotAPIBackend::GetDatai(XPLMDataRef) { return 0; }
+float XPilotAPIBackend::GetDataf(XPLMDataRef) { return 0.0f; }
+int XPilotAPIBackend::GetDatab(XPLMDataRef, void*, int, int) { return 0; }
+void XPilotAPIBackend::SetDatai(XPLMDataRef, int) {}
+void XPilotAPIBackend::SetDataf(XPLMDataRef, float) {}
+XPLMDataRef XPilotAPIBackend::RegisterDataAccessor(const char*, XPLMDataTypeID, XPLMGetDatai_f, XPLMGetDataf_f, XPLMGetDatavi_f, XPLMGetDatab_f, void*) { return NULL; }
+void XPilotAPIBackend::UnregisterDataAccessor(XPLMDataRef) {}
+
+#endif // XPILOTAPI_NO_XPLM
+
+//
+// MARK: XPilotAPIArrayBackend
+//
+
+// xPilot is always installed, setXPilotAvail() enables and disables it
+XPLMPluginID
+XPilotAPIArrayBackend::FindPluginBySignature(const char* inSignature)
+{
+    return !strcmp(inSignature, XPILOT_PLUGIN_SIGNATURE) ? 1 : XPLM_NO_PLUGIN_ID;
+}
+
+int
+XPilotAPIArrayBackend::IsPluginEnabled(XPLMPluginID inPluginID)
+{
+    return bXPilotAvail && inPluginID == 1;
+}
+
+XPLMDataRef
+XPilotAPIArrayBackend::FindDataRef(const char* inDataRefName)
+{
+    static const char* aNames[] = {
+        "xpilot/num_aircraft", "xpilot/ai_controlled", "xpilot/bulk/quick", "xpilot/bulk/expensive"
+    };
+    for (size_t i = 0; i < sizeof(aNames) / sizeof(aNames[0]); i++)
+        if (!strcmp(inDataRefName, aNames[i]))
+            return reinterpret_cast<XPLMDataRef>(intptr_t(i + 1));
+    for (size_t i = 0; i < vOwnDR.size(); i++)
+        if (vOwnDR[i].name == inDataRefName)
+            return reinterpret_cast<XPLMDataRef>(intptr_t(DR_OWN_FIRST + i));
+    return NULL;
+}
+
+XPLMDataRef
+XPilotAPIArrayBackend::RegisterDataAccessor(const char* inDataName, XPLMDataTypeID inDataType,
+                                            XPLMGetDatai_f inReadInt, XPLMGetDataf_f inReadFloat,
+                                            XPLMGetDatavi_f inReadIntArray, XPLMGetDatab_f inReadData,
+                                            void* inRefcon)
+{
+    OwnDataRefTy dr;
+    dr.name = inDataName;
+    dr.type = inDataType;
+    dr.fInt = inReadInt;
+    dr.fFloat = inReadFloat;
+    dr.fIntArray = inReadIntArray;
+    dr.fData = inReadData;
+    dr.refcon = inRefcon;
+    // reuse a free slot
+    size_t i = 0;
+    while (i < vOwnDR.size() && !vOwnDR[i].name.empty())
+        i++;
+    if (i < vOwnDR.size())
+        vOwnDR[i] = dr;
+    else
+        vOwnDR.push_back(dr);
+    return reinterpret_cast<XPLMDataRef>(intptr_t(DR_OWN_FIRST + i));
+}
+
+void
+XPilotAPIArrayBackend::UnregisterDataAccessor(XPLMDataRef inDataRef)
+{
+    const intptr_t i = intptr_t(inDataRef) - DR_OWN_FIRST;
+    if (i >= 0 && size_t(i) < vOwnDR.size())
+        vOwnDR[size_t(i)] = OwnDataRefTy();
+}
+
+const XPilotAPIArrayBackend::OwnDataRefTy*
+XPilotAPIArrayBackend::GetOwnDR(XPLMDataRef inDataRef) const
+{
+    const intptr_t i = intptr_t(inDataRef) - DR_OWN_FIRST;
+    if (i < 0 || size_t(i) >= vOwnDR.size() || vOwnDR[size_t(i)].name.empty())
+        return nullptr;
+    return &vOwnDR[size_t(i)];
+}
+
+XPLMDataTypeID
+XPilotAPIArrayBackend::GetDataRefTypes(XPLMDataRef inDataRef)
+{
+    switch (intptr_t(inDataRef)) {
+    case DR_NUM_AC:
+    case DR_AI_CONTROLLED:  return xplmType_Int;
+    case DR_BULK_QUICK:
+    case DR_BULK_EXPSV:     return xplmType_Data;
+    default: {
+        const OwnDataRefTy* pDR = GetOwnDR(inDataRef);
+        return pDR ? pDR->type : xplmType_Unknown;
+    }
+    }
+}
+
+int
+XPilotAPIArrayBackend::GetDatai(XPLMDataRef inDataRef)
+{
+    const OwnDataRefTy* pDR = GetOwnDR(inDataRef);
+    if (pDR)
+        return pDR->fInt ? pDR->fInt(pDR->refcon) : 0;
+    return intptr_t(inDataRef) == DR_NUM_AC && bXPilotAvail ? getNumAc() : 0;
+}
+
+float
+XPilotAPIArrayBackend::GetDataf(XPLMDataRef inDataRef)
+{
+    const OwnDataRefTy* pDR = GetOwnDR(inDataRef);
+    if (pDR)
+        return pDR->fFloat ? pDR->fFloat(pDR->refcon) : 0.0f;
+    return float(GetDatai(inDataRef));
+}
+
+// Like xPilot: Called with `outValue == NULL` returns the size of one record
+int
+XPilotAPIArrayBackend::GetDatab(XPLMDataRef inDataRef, void* outValue, int inOffset, int inMaxBytes)
+{
+    const void* pData = nullptr;
+    int recSize = 0;
+    switch (intptr_t(inDataRef)) {
+    case DR_BULK_QUICK:
+        pData = vBulk.data();
+        recSize = int(sizeof(XPilotAPIAircraft::XPilotAPIBulkData));
+        break;
+    case DR_BULK_EXPSV:
+        pData = vInfo.data();
+        recSize = int(sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts));
+        break;
+    default: {
+        const OwnDataRefTy* pDR = GetOwnDR(inDataRef);
+        return pDR && pDR->fData ? pDR->fData(pDR->refcon, outValue, inOffset, inMaxBytes) : 0;
+    }
+    }
+
+    numDatabCalls++;
+    if (!outValue)
+        return recSize;
+
+    const int total = getNumAc() * recSize;
+    if (inOffset < 0 || inOffset >= total)
+        return 0;
+    const int len = std::min(inMaxBytes, total - inOffset);
+    memcpy(outValue, static_cast<const char*>(pData) + inOffset, size_t(len));
+    numDatabBytes += len;
+    return len;
+}
+
+//
+// MARK: XPilotAPISyntheticBackend
+//
+
+XPilotAPISyntheticBackend::XPilotAPISyntheticBackend() :
+    XPilotAPISyntheticBackend(ConfigTy())
+{}
+
+XPilotAPISyntheticBackend::XPilotAPISyntheticBackend(const ConfigTy& _cfg) :
+    cfg(_cfg),
+    rngState(_cfg.seed ? _cfg.seed : 1)
+{
+    setNumAc(cfg.numAc);
+}
+
+// xorshift64*, deterministic for a given seed and cheap
+double
+XPilotAPISyntheticBackend::rnd()
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return double((rngState * 0x2545F4914F6CDD1Dull) >> 11) / double(1ull << 53);
+}
+
+void
+XPilotAPISyntheticBackend::newAc(size_t i)
+{
+    static const char* aTypes[] = { "A320", "B738", "A21N", "B77W", "E75L", "CRJ9", "B789", "A333" };
+    static const char* aWtc[]   = { "M",    "M",    "M",    "H",    "M",    "M",    "H",    "H"    };
+    static const char* aApt[]   = { "KJFK", "KLGA", "KEWR", "KBOS", "KORD", "KATL", "EGLL", "EDDF" };
+
+    XPilotAPIAircraft::XPilotAPIBulkData& b = vBulk[i];
+    b = XPilotAPIAircraft::XPilotAPIBulkData();
+    b.keyNum = nextKey++;
+    const double dist = cfg.radiusNm * std::sqrt(rnd());
+    const double brg = rnd() * 2.0 * XPilotAPI::PI;
+    b.lat = cfg.centerLat + dist / 60.0 * std::cos(brg);
+    b.lon = cfg.centerLon + dist / 60.0 * std::sin(brg) / std::cos(XPilotAPI::deg2rad(cfg.centerLat));
+    b.bits.onGnd = rnd() < 0.2;
+    b.alt_ft = b.bits.onGnd ? 20.0 : 2000.0 + rnd() * 35000.0;
+    b.heading = float(rnd() * 360.0);
+    b.speed_kt = b.bits.onGnd ? float(rnd() * 20.0) : float(180.0 + rnd() * 300.0);
+    b.gear = b.bits.onGnd ? 1.0f : 0.0f;
+    b.bits.nav = b.bits.bcn = true;
+    b.bits.strb = b.bits.land = !b.bits.onGnd;
+    b.bits.taxi = b.bits.onGnd;
+
+    XPilotAPIAircraft::XPilotAPIBulkInfoTexts& t = vInfo[i];
+    t = XPilotAPIAircraft::XPilotAPIBulkInfoTexts();
+    t.keyNum = b.keyNum;
+    const size_t ty = size_t(rnd() * 8.0);
+    strcpy(t.modelIcao, aTypes[ty]);
+    strcpy(t.acClass, "L2J");
+    strcpy(t.wtc, aWtc[ty]);
+    snprintf(t.callSign, sizeof(t.callSign), "SYN%04u", unsigned(b.keyNum % 10000));
+    snprintf(t.squawk, sizeof(t.squawk), "%04o", unsigned(b.keyNum % 4096));
+    strcpy(t.origin, aApt[size_t(rnd() * 8.0)]);
+    strcpy(t.destination, aApt[size_t(rnd() * 8.0)]);
+    snprintf(t.cslModel, sizeof(t.cslModel), "Synthetic/%s", t.modelIcao);
+}
+
+void
+XPilotAPISyntheticBackend::setNumAc(int n)
+{
+    const size_t oldN = vBulk.size();
+    vBulk.resize(size_t(std::max(0, n)));
+    vInfo.resize(size_t(std::max(0, n)));
+    for (size_t i = oldN; i < vBulk.size(); i++)
+        newAc(i);
+}
+
+void
+XPilotAPISyntheticBackend::step(double dtSec)
+{
+    const double cosCenter = std::cos(XPilotAPI::deg2rad(cfg.centerLat));
+    for (XPilotAPIAircraft::XPilotAPIBulkData& b : vBulk)
+    {
+        // fly straight, turn back towards the center when too far out
+        const double dNorth = (b.lat - cfg.centerLat) * 60.0;
+        const double dEast  = (b.lon - cfg.centerLon) * 60.0 * cosCenter;
+        if (dNorth * dNorth + dEast * dEast > cfg.radiusNm * cfg.radiusNm)
+            b.heading = float(std::fmod(std::atan2(-dEast, -dNorth) * 180.0 / XPilotAPI::PI + 360.0, 360.0));
+        const double distNm = b.speed_kt * dtSec / 3600.0;
+        const double hdg = XPilotAPI::deg2rad(b.heading);
+        b.lat += distNm / 60.0 * std::cos(hdg);
+        b.lon += distNm / 60.0 * std::sin(hdg) / cosCenter;
+        b.dist_nm = float(std::sqrt(dNorth * dNorth + dEast * dEast));
+        b.bearing = float(std::fmod(std::atan2(dEast, dNorth) * 180.0 / XPilotAPI::PI + 360.0, 360.0));
+    }
+
+    // replace aircraft by new ones
+    churnDue += cfg.churnPerSec * dtSec;
+    for (; churnDue >= 1.0 && !vBulk.empty(); churnDue -= 1.0)
+        newAc(size_t(rnd() * double(vBulk.size())));
+}
+
+//
+// MARK: XPilotAPIRecorder
+//
+
+// Record differences are made of 4-byte words
+constexpr size_t REC_WORD = 4;
+
+// Appends `pRec` to `out` as difference to `pRef`: a bitmask of changed words
+// followed by the changed words, then updates `pRef`
+static void EncodeRecord(std::vector<uint8_t>& out, const uint8_t* pRec, uint8_t* pRef, size_t recSize)
+{
+    const size_t numWords = (recSize + REC_WORD - 1) / REC_WORD;
+    const size_t posMask = out.size();
+    out.resize(posMask + (numWords + 7) / 8, 0);
+    for (size_t w = 0; w < numWords; w++) {
+        const size_t off = w * REC_WORD;
+        const size_t len = std::min(REC_WORD, recSize - off);
+        if (memcmp(pRec + off, pRef + off, len)) {
+            out[posMask + w / 8] |= uint8_t(1u << (w % 8));
+            out.insert(out.end(), pRec + off, pRec + off + len);
+        }
+    }
+    memcpy(pRef, pRec, recSize);
+}
+
+// Applies one difference written by EncodeRecord() to `pRec`,
+// returns the position after it or `nullptr` if beyond `pEnd`
+static const uint8_t* DecodeRecord(const uint8_t* p, const uint8_t* pEnd, uint8_t* pRec, size_t recSize)
+{
+    const size_t numWords = (recSize + REC_WORD - 1) / REC_WORD;
+    const uint8_t* pMask = p;
+    p += (numWords + 7) / 8;
+    if (p > pEnd)
+        return nullptr;
+    for (size_t w = 0; w < numWords; w++) {
+        if (pMask[w / 8] & (1u << (w % 8))) {
+            const size_t off = w * REC_WORD;
+            const size_t len = std::min(REC_WORD, recSize - off);
+            if (p + len > pEnd)
+                return nullptr;
+            memcpy(pRec + off, p, len);
+            p += len;
+        }
+    }
+    return p;
+}
+
+size_t
+XPilotAPIRecorder::getRecSize(int stream)
+{
+    return stream == STREAM_BULK ? sizeof(XPilotAPIAircraft::XPilotAPIBulkData) :
+                                   sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts);
+}
+
+// The header is flushed right away, so that an unwritable file fails here
+bool
+XPilotAPIRecorder::open(const std::string& path)
+{
+    close();
+    bFailed = false;
+    pFile = fopen(path.c_str(), "wb");
+    if (!pFile) {
+        bFailed = true;
+        return false;
+    }
+
+    FileHeaderTy hdr = {};
+    memcpy(hdr.magic, "XPAPIREC", sizeof(hdr.magic));
+    hdr.version = VERSION;
+    hdr.sizeBulk = uint32_t(getRecSize(STREAM_BULK));
+    hdr.sizeInfo = uint32_t(getRecSize(STREAM_INFO));
+    if (fwrite(&hdr, sizeof(hdr), 1, pFile) != 1 || fflush(pFile) != 0) {
+        fclose(pFile);
+        pFile = nullptr;
+        bFailed = true;
+        return false;
+    }
+    fileOffset = sizeof(hdr);
+    for (std::vector<uint8_t>& vRef : aRef)
+        vRef.clear();
+    vIndex.clear();
+    return true;
+}
+
+bool
+XPilotAPIRecorder::close()
+{
+    if (!pFile)
+        return !bFailed;
+    endFrame();
+
+    // index at the end, then the header pointing to it,
+    // but only if the frames before the index made it to the file
+    if (!bFailed) {
+        FileHeaderTy hdr = {};
+        memcpy(hdr.magic, "XPAPIREC", sizeof(hdr.magic));
+        hdr.version = VERSION;
+        hdr.sizeBulk = uint32_t(getRecSize(STREAM_BULK));
+        hdr.sizeInfo = uint32_t(getRecSize(STREAM_INFO));
+        hdr.numFrames = vIndex.size();
+        hdr.indexOffset = fileOffset;
+        if ((!vIndex.empty() && fwrite(vIndex.data(), sizeof(IndexEntryTy), vIndex.size(), pFile) != vIndex.size()) ||
+            fflush(pFile) != 0 ||
+            fseek(pFile, 0, SEEK_SET) != 0 ||
+            fwrite(&hdr, sizeof(hdr), 1, pFile) != 1)
+            bFailed = true;
+    }
+    if (fclose(pFile) != 0)
+        bFailed = true;
+    pFile = nullptr;
+    return !bFailed;
+}
+
+void
+XPilotAPIRecorder::beginFrame(double ts, int numAc)
+{
+    if (!pFile || bFailed)
+        return;
+    endFrame();
+
+    frameHdr = FrameHeaderTy();
+    frameHdr.magic = FRAME_MAGIC;
+    frameHdr.ts = ts;
+    frameHdr.numAc = std::max(numAc, 0);
+    if (keyframeInterval <= 1 || vIndex.size() % size_t(keyframeInterval) == 0)
+        frameHdr.flags |= FRAME_KEY;
+    vFrame.clear();
+    bInFrame = true;
+
+    // positions beyond the number of aircraft are forgotten, same as in replay
+    for (int stream = 0; stream < NUM_STREAMS; stream++)
+        aRef[size_t(stream)].resize(size_t(frameHdr.numAc) * getRecSize(stream), 0);
+}
+
+void
+XPilotAPIRecorder::addRecords(int first, const XPilotAPIAircraft::XPilotAPIBulkData* pBulk, int num)
+{
+    addRecords(STREAM_BULK, first, pBulk, num);
+}
+
+void
+XPilotAPIRecorder::addRecords(int first, const XPilotAPIAircraft::XPilotAPIBulkInfoTexts* pInfo, int num)
+{
+    addRecords(STREAM_INFO, first, pInfo, num);
+}
+
+// Keyframes only update the reference here, endFrame() writes the full arrays
+void
+XPilotAPIRecorder::addRecords(int stream, int first, const void* pRecs, int num)
+{
+    if (!bInFrame || first < 0)
+        return;
+    num = std::min(num, frameHdr.numAc - first);
+    if (num <= 0)
+        return;
+
+    const size_t recSize = getRecSize(stream);
+    const uint8_t* pRec = static_cast<const uint8_t*>(pRecs);
+    uint8_t* pRef = aRef[size_t(stream)].data() + size_t(first) * recSize;
+    if (frameHdr.flags & FRAME_KEY) {
+        memcpy(pRef, pRec, size_t(num) * recSize);
+        return;
+    }
+
+    AddBlock(stream, false, first, num);
+    for (int i = 0; i < num; i++, pRec += recSize, pRef += recSize)
+        EncodeRecord(vFrame, pRec, pRef, recSize);
+}
+
+void
+XPilotAPIRecorder::AddBlock(int stream, bool bRaw, int first, int num)
+{
+    BlockHeaderTy blk = {};
+    blk.stream = uint8_t(stream);
+    blk.bRaw = bRaw ? 1 : 0;
+    blk.first = first;
+    blk.num = num;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&blk);
+    vFrame.insert(vFrame.end(), p, p + sizeof(blk));
+    frameHdr.numBlocks++;
+}
+
+void
+XPilotAPIRecorder::endFrame()
+{
+    if (!pFile || !bInFrame)
+        return;
+    bInFrame = false;
+
+    if (frameHdr.flags & FRAME_KEY) {
+        for (int stream = 0; stream < NUM_STREAMS; stream++) {
+            if (frameHdr.numAc > 0) {
+                AddBlock(stream, true, 0, frameHdr.numAc);
+                const std::vector<uint8_t>& vRef = aRef[size_t(stream)];
+                vFrame.insert(vFrame.end(), vRef.begin(), vRef.end());
+            }
+        }
+    }
+
+    // a frame only counts once it's written completely
+    frameHdr.size = vFrame.size();
+    if (fwrite(&frameHdr, sizeof(frameHdr), 1, pFile) != 1 ||
+        (!vFrame.empty() && fwrite(vFrame.data(), 1, vFrame.size(), pFile) != vFrame.size())) {
+        bFailed = true;
+        return;
+    }
+    vIndex.push_back({ fileOffset, frameHdr.ts, frameHdr.flags, 0 });
+    fileOffset += sizeof(frameHdr) + vFrame.size();
+}
+
+//
+// MARK: XPilotAPIReplayBackend
+//
+
+bool
+XPilotAPIReplayBackend::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    FILE* pFile = fopen(path.c_str(), "rb");
+    if (!pFile)
+        return false;
+    fseek(pFile, 0, SEEK_END);
+    const long len = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    vFileData.resize(len > 0 ? size_t(len) : 0);
+    const size_t numRead = vFileData.empty() ? 0 : fread(vFileData.data(), 1, vFileData.size(), pFile);
+    fclose(pFile);
+    if (numRead != vFileData.size() || vFileData.empty())
+        return false;
+    pData = vFileData.data();
+    dataLen = vFileData.size();
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    pData = static_cast<const uint8_t*>(p);
+    dataLen = size_t(st.st_size);
+#endif
+
+    // validate the header, we can only replay records of our own size
+    XPilotAPIRecorder::FileHeaderTy hdr;
+    if (dataLen < sizeof(hdr)) {
+        close();
+        return false;
+    }
+    memcpy(&hdr, pData, sizeof(hdr));
+    if (memcmp(hdr.magic, "XPAPIREC", sizeof(hdr.magic)) ||
+        hdr.version != XPilotAPIRecorder::VERSION ||
+        hdr.sizeBulk != XPilotAPIRecorder::getRecSize(XPilotAPIRecorder::STREAM_BULK) ||
+        hdr.sizeInfo != XPilotAPIRecorder::getRecSize(XPilotAPIRecorder::STREAM_INFO)) {
+        close();
+        return false;
+    }
+
+    // use the index if the recording was closed properly, otherwise walk the frames
+    if (hdr.indexOffset && hdr.indexOffset + hdr.numFrames * sizeof(XPilotAPIRecorder::IndexEntryTy) <= dataLen) {
+        vIndex.resize(size_t(hdr.numFrames));
+        if (!vIndex.empty())
+            memcpy(vIndex.data(), pData + hdr.indexOffset, vIndex.size() * sizeof(XPilotAPIRecorder::IndexEntryTy));
+    }
+    else if (!ScanFrames(sizeof(hdr))) {
+        close();
+        return false;
+    }
+
+    bXPilotAvail = true;
+    return true;
+}
+
+void
+XPilotAPIReplayBackend::close()
+{
+#ifdef _WIN32
+    vFileData.clear();
+#else
+    if (pData)
+        munmap(const_cast<uint8_t*>(pData), dataLen);
+#endif
+    pData = nullptr;
+    dataLen = 0;
+    vIndex.clear();
+    vBulk.clear();
+    vInfo.clear();
+    currFrame = SIZE_MAX;
+    bXPilotAvail = false;
+}
+
+bool
+XPilotAPIReplayBackend::ScanFrames(uint64_t offset)
+{
+    vIndex.clear();
+    XPilotAPIRecorder::FrameHeaderTy fh;
+    while (offset + sizeof(fh) <= dataLen) {
+        memcpy(&fh, pData + offset, sizeof(fh));
+        if (fh.magic != XPilotAPIRecorder::FRAME_MAGIC || offset + sizeof(fh) + fh.size > dataLen)
+            break;                      // end of a recording cut short
+        vIndex.push_back({ offset, fh.ts, fh.flags, 0 });
+        offset += sizeof(fh) + fh.size;
+    }
+    return !vIndex.empty();
+}
+
+bool
+XPilotAPIReplayBackend::nextFrame()
+{
+    const size_t next = currFrame == SIZE_MAX ? 0 : currFrame + 1;
+    if (next >= vIndex.size())
+        return false;
+    return ApplyFrame(next);
+}
+
+bool
+XPilotAPIReplayBackend::seekFrame(size_t i)
+{
+    if (i >= vIndex.size())
+        return false;
+    // continue from the current frame if that is closer than the last keyframe
+    size_t k = i;
+    while (k > 0 && !(vIndex[k].flags & XPilotAPIRecorder::FRAME_KEY))
+        k--;
+    if (currFrame != SIZE_MAX && currFrame >= k && currFrame <= i)
+        k = currFrame + 1;
+    for (; k <= i; k++)
+        if (!ApplyFrame(k))
+            return false;
+    return true;
+}
+
+bool
+XPilotAPIReplayBackend::seekTime(double ts)
+{
+    const auto it = std::upper_bound(vIndex.begin(), vIndex.end(), ts,
+        [](double t, const XPilotAPIRecorder::IndexEntryTy& e) { return t < e.ts; });
+    if (it == vIndex.begin())
+        return false;
+    return seekFrame(size_t(it - vIndex.begin()) - 1);
+}
+
+bool
+XPilotAPIReplayBackend::ApplyFrame(size_t i)
+{
+    XPilotAPIRecorder::FrameHeaderTy fh;
+    const uint64_t offset = vIndex[i].offset;
+    if (offset + sizeof(fh) > dataLen)
+        return false;
+    memcpy(&fh, pData + offset, sizeof(fh));
+    const uint8_t* p = pData + offset + sizeof(fh);
+    const uint8_t* pEnd = p + fh.size;
+    if (fh.magic != XPilotAPIRecorder::FRAME_MAGIC || pEnd > pData + dataLen)
+        return false;
+
+    vBulk.resize(size_t(fh.numAc));
+    vInfo.resize(size_t(fh.numAc));
+    for (uint32_t b = 0; b < fh.numBlocks; b++)
+    {
+        XPilotAPIRecorder::BlockHeaderTy blk;
+        if (p + sizeof(blk) > pEnd)
+            return false;
+        memcpy(&blk, p, sizeof(blk));
+        p += sizeof(blk);
+        if (blk.first < 0 || blk.num < 0 || blk.first + blk.num > fh.numAc)
+            return false;
+
+        const size_t recSize = XPilotAPIRecorder::getRecSize(blk.stream);
+        uint8_t* pRec = blk.stream == XPilotAPIRecorder::STREAM_BULK ?
+            reinterpret_cast<uint8_t*>(vBulk.data() + blk.first) :
+            reinterpret_cast<uint8_t*>(vInfo.data() + blk.first);
+        if (blk.bRaw) {
+            const size_t len = size_t(blk.num) * recSize;
+            if (p + len > pEnd)
+                return false;
+            memcpy(pRec, p, len);
+            p += len;
+        }
+        else {
+            for (int r = 0; r < blk.num; r++, pRec += recSize)
+                if (!(p = DecodeRecord(p, pEnd, pRec, recSize)))
+                    return false;
+        }
+    }
+    currFrame = i;
+    return true;
+}
+
+//
+// MARK: XPilotAPIShmExporter
+//
+
+bool
+XPilotAPIShmExporter::open(const std::string& _name, uint32_t capacity)
+{
+    close();
+    const size_t len = sizeof(XPilotAPIShmHeader) - sizeof(XPilotAPISharedFleet) +
+                       XPilotAPISharedFleet::getSize(capacity);
+    void* p = nullptr;
+#ifdef _WIN32
+    hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                  DWORD(uint64_t(len) >> 32), DWORD(len & 0xFFFFFFFF), _name.c_str());
+    if (!hMapping)
+        return false;
+    p = MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, len);
+    if (!p) {
+        CloseHandle(hMapping);
+        hMapping = nullptr;
+        return false;
+    }
+#else
+    const int fd = shm_open(_name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, off_t(len)) == 0)
+        p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (!p || p == MAP_FAILED) {
+        shm_unlink(_name.c_str());
+        return false;
+    }
+#endif
+    name = _name;
+    size = len;
+
+    // the header is written last, so readers never see a valid magic with a wrong layout
+    pHdr = static_cast<XPilotAPIShmHeader*>(p);
+    pHdr->magic = 0;
+    pHdr->version = XPilotAPIShmHeader::VERSION;
+    pHdr->sizeBulk = uint32_t(sizeof(XPilotAPIAircraft::XPilotAPIBulkData));
+    pHdr->sizeInfo = uint32_t(sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts));
+    pHdr->totalSize = len;
+    new (&pHdr->fleet) XPilotAPISharedFleet();
+    pHdr->fleet.seq.store(0);
+    pHdr->fleet.capacity = capacity;
+    pHdr->fleet.numAc = 0;
+    pHdr->fleet.numAcTotal = 0;
+    pHdr->fleet.frame = 0;
+    pHdr->fleet.ts = 0.0;
+    std::atomic_thread_fence(std::memory_order_release);
+    pHdr->magic = XPilotAPIShmHeader::MAGIC;
+    return true;
+}
+
+void
+XPilotAPIShmExporter::close()
+{
+    if (!pHdr)
+        return;
+    pHdr->magic = 0;                    // tells readers the region is gone
+#ifdef _WIN32
+    UnmapViewOfFile(pHdr);
+    CloseHandle(hMapping);
+    hMapping = nullptr;
+#else
+    munmap(pHdr, size);
+    shm_unlink(name.c_str());
+#endif
+    pHdr = nullptr;
+    size = 0;
+}
+
+void
+XPilotAPIShmExporter::write(const XPilotAPIAcStore& store)
+{
+    if (!pHdr)
+        return;
+    XPilotAPISharedFleet& fleet = pHdr->fleet;
+    const int numAc = std::min(store.size(), int(fleet.capacity));
+
+    fleet.seq.fetch_add(1, std::memory_order_acq_rel);          // odd: writing
+    std::atomic_thread_fence(std::memory_order_release);
+    XPilotAPIAircraft::XPilotAPIBulkData* pBulk = fleet.bulk();
+    XPilotAPIAircraft::XPilotAPIBulkInfoTexts* pInfo = fleet.info();
+    XPilotAPISharedStampTy* pStamp = fleet.stamp();
+    for (int i = 0; i < numAc; i++) {
+        pBulk[i] = store[i]->getBulk();
+        pInfo[i] = store[i]->getInfo();
+        pStamp[i].bulk = pStamp[i].info = fleet.frame + 1;
+    }
+    fleet.numAc = numAc;
+    fleet.numAcTotal = uint32_t(store.size());
+    fleet.frame++;
+    fleet.ts = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    fleet.seq.fetch_add(1, std::memory_order_release);          // even: done
+}
+
+//
+// MARK: XPilotAPIShmReader
+//
+
+bool
+XPilotAPIShmReader::open(const std::string& name)
+{
+    close();
+    void* p = nullptr;
+    size_t len = 0;
+#ifdef _WIN32
+    hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (!hMapping)
+        return false;
+    p = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION mbi;
+    if (p && VirtualQuery(p, &mbi, sizeof(mbi)))
+        len = mbi.RegionSize;
+    if (!p || len < sizeof(XPilotAPIShmHeader)) {
+        if (p) UnmapViewOfFile(p);
+        CloseHandle(hMapping);
+        hMapping = nullptr;
+        return false;
+    }
+#else
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(XPilotAPIShmHeader)) {
+        len = size_t(st.st_size);
+        p = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (!p || p == MAP_FAILED)
+        return false;
+#endif
+    pHdr = static_cast<XPilotAPIShmHeader*>(p);
+    size = len;
+
+    if (pHdr->magic != XPilotAPIShmHeader::MAGIC ||
+        pHdr->version != XPilotAPIShmHeader::VERSION ||
+        pHdr->sizeBulk != sizeof(XPilotAPIAircraft::XPilotAPIBulkData) ||
+        pHdr->sizeInfo != sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts) ||
+        pHdr->totalSize > size ||
+        XPilotAPISharedFleet::getSize(pHdr->fleet.capacity) > size - (sizeof(XPilotAPIShmHeader) - sizeof(XPilotAPISharedFleet))) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void
+XPilotAPIShmReader::close()
+{
+    if (!pHdr)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(pHdr);
+    CloseHandle(hMapping);
+    hMapping = nullptr;
+#else
+    munmap(pHdr, size);
+#endif
+    pHdr = nullptr;
+    size = 0;
+}
+
+uint32_t
+XPilotAPIShmReader::beginRead() const
+{
+    return pHdr->fleet.seq.load(std::memory_order_acquire);
+}
+
+bool
+XPilotAPIShmReader::endRead(uint32_t seq) const
+{
+    if (seq & 1)                    // read while a frame was being written
+        return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return pHdr->fleet.seq.load(std::memory_order_relaxed) == seq;
+}
+
+bool
+XPilotAPIShmReader::read(std::vector<XPilotAPIAircraft::XPilotAPIBulkData>& vBulk,
+                         std::vector<XPilotAPIAircraft::XPilotAPIBulkInfoTexts>& vInfo,
+                         uint64_t& frame, double& ts, int maxTries,
+                         uint32_t* pNumAcTotal) const
+{
+    if (!pHdr || pHdr->magic != XPilotAPIShmHeader::MAGIC)
+        return false;
+    const XPilotAPISharedFleet& fleet = pHdr->fleet;
+    for (int attempt = 0; attempt < maxTries; attempt++)
+    {
+        const uint32_t seq = beginRead();
+        if (seq & 1) {              // being written, or the writer died while writing
+            std::this_thread::yield();
+            continue;
+        }
+        const int numAc = std::max(0, std::min(fleet.numAc, int(fleet.capacity)));
+        vBulk.resize(size_t(numAc));
+        vInfo.resize(size_t(numAc));
+        if (numAc > 0) {
+            memcpy(vBulk.data(), fleet.bulk(), size_t(numAc) * sizeof(XPilotAPIAircraft::XPilotAPIBulkData));
+            memcpy(vInfo.data(), fleet.info(), size_t(numAc) * sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts));
+        }
+        frame = fleet.frame;
+        ts = fleet.ts;
+        if (pNumAcTotal)
+            *pNumAcTotal = fleet.numAcTotal;
+        if (endRead(seq))
+            return true;
+    }
+    return false;
+}
+
+//
+// MARK: XPilotDataRef
+//
+
+XPilotDataRef::XPilotDataRef(std::string _sDataRef) :
+    sDataRef(_sDataRef)
+{}
+
+bool 
+XPilotDataRef::isValid()
+{
+    if (needsInit()) FindDataRef();
+    return bValid;
+}
+
+bool 
+XPilotDataRef::FindDataRef()
+{
+    XPilotAPIBackend& backend = XPilotAPIBackend::get();
+    backendGen = XPilotAPIBackend::getGeneration();
+    dataRef = backend.FindDataRef(sDataRef.c_str());
+    dataTypes = dataRef ? (backend.GetDataRefTypes(dataRef) & usefulTypes) : xplmType_Unknown;
+    return bValid = dataTypes != xplmType_Unknown;
+}
+
+int 
+XPilotDataRef::getInt()
+{
+    if (needsInit()) FindDataRef();
+    return XPilotAPIBackend::get().GetDatai(dataRef);
+}
+
+float 
+XPilotDataRef::getFloat()
+{
+    if (needsInit()) FindDataRef();
+    return XPilotAPIBackend::get().GetDataf(dataRef);
+}
+
+int 
+XPilotDataRef::getData(void* pOut, int inOffset, int inMaxBytes)
+{
+    if (needsInit()) FindDataRef();
+    return XPilotAPIBackend::get().GetDatab(dataRef, pOut, inOffset, inMaxBytes);
+}
+
+void 
+XPilotDataRef::set(int i)
+{
+    if (needsInit()) FindDataRef();
+    XPilotAPIBackend::get().SetDatai(dataRef, i);
+}
+
+void 
+XPilotDataRef::set(float f)
+{
+    if (needsInit()) FindDataRef();
+    XPilotAPIBackend::get().SetDataf(dataRef, f);
+}
+
+//
+// MARK: XPilotAPIBinding
+//
+
+XPilotAPIBinding&
+XPilotAPIBinding::get()
+{
+    static XPilotAPIBinding binding;
+    return binding;
+}
+
+XPilotAPIBinding::StateTy
+XPilotAPIBinding::check()
+{
+    XPilotAPIBackend& backend = XPilotAPIBackend::get();
+    if (bInvalid || backendGen != XPilotAPIBackend::getGeneration()) {
+        bInvalid = false;
+        backendGen = XPilotAPIBackend::getGeneration();
+        state = NOT_FOUND;
+        pluginId = XPLM_NO_PLUGIN_ID;
+        tNextRetry = std::chrono::steady_clock::time_point();
+    }
+
+    // search for the plugin only every so often
+    if (state == NOT_FOUND) {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now < tNextRetry)
+            return state;
+        pluginId = backend.FindPluginBySignature(XPILOT_PLUGIN_SIGNATURE);
+        if (pluginId == XPLM_NO_PLUGIN_ID) {
+            tNextRetry = now + retryPeriod;
+            return state;
+        }
+        state = DISABLED;
+    }
+
+    // the per-frame path: just one cheap call
+    if (!backend.IsPluginEnabled(pluginId)) {
+        state = DISABLED;
+        // a reloaded xPilot comes back under a new id, the old one stays disabled
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now < tNextRetry)
+            return state;
+        tNextRetry = now + retryPeriod;
+        const XPLMPluginID id = backend.FindPluginBySignature(XPILOT_PLUGIN_SIGNATURE);
+        if (id == XPLM_NO_PLUGIN_ID)
+            state = NOT_FOUND;
+        else if (id != pluginId && backend.IsPluginEnabled(id))
+            BindDataRefs(now);
+        pluginId = id;
+    }
+    else if (state == DISABLED)
+        BindDataRefs(std::chrono::steady_clock::now());
+    else if (state == INCOMPATIBLE) {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= tNextRetry)
+            BindDataRefs(now);
+    }
+    return state;
+}
+
+void
+XPilotAPIBinding::BindDataRefs(std::chrono::steady_clock::time_point now)
+{
+    // `ai_controlled` is optional
+    drAIControlled.FindDataRef();
+    const bool bNumAc = drNumAc.FindDataRef();
+    const bool bQuick = drBulkQuick.FindDataRef();
+    const bool bExpsv = drBulkExpsv.FindDataRef();
+    if (bNumAc && bQuick && bExpsv) {
+        state = BOUND;
+        generation++;
+    }
+    else {
+        state = INCOMPATIBLE;
+        tNextRetry = now + retryPeriod;
+    }
+}
@@ -27,22 +27,136 @@
 #ifndef XPilotAPI_h
 #define XPilotAPI_h
 
+#include <cstdio>
 #include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <new>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <list>
 #include <map>
+#include <array>
+#include <unordered_map>
+#include <vector>
+#include <tuple>
+#include <type_traits>
+#include <limits>
+#include <atomic>
 #include <chrono>
 
+#if !defined(XPILOTAPI_NO_XPLM) || __has_include("XPLMDataAccess.h")
 #include "XPLMDataAccess.h"
+#else
+// Built without XPLM and without its SDK: the few declarations the backend interface needs
+typedef int XPLMPluginID;
+#define XPLM_NO_PLUGIN_ID (-1)
+typedef void* XPLMDataRef;
+typedef int XPLMDataTypeID;
+enum {
+    xplmType_Unknown = 0, xplmType_Int = 1, xplmType_Float = 2, xplmType_Double = 4,
+    xplmType_FloatArray = 8, xplmType_IntArray = 16, xplmType_Data = 32
+};
+typedef int (*XPLMGetDatai_f)(void* inRefcon);
+typedef float (*XPLMGetDataf_f)(void* inRefcon);
+typedef int (*XPLMGetDatavi_f)(void* inRefcon, int* outValues, int inOffset, int inMax);
+typedef int (*XPLMGetDatab_f)(void* inRefcon, void* outValue, int inOffset, int inMaxLength);
+#endif
 
 class XPilotDataRef;
+class XPilotAPIRecorder;
+
+// Id of an interned string, see XPilotAPIStrPool
+typedef uint32_t XPilotAPIStrId;
+
+// Pool of interned strings
+//
+// Each distinct text gets a small integer id, so that repeated values like
+// aircraft types or airports can be compared and grouped by integer.
+// The empty string always has id 0. Ids are process-wide and never change.
+// @note Not thread-safe, to be used from the sim thread only.
+class XPilotAPIStrPool
+{
+public:
+    // Returned by find() for unknown texts, never assigned to any aircraft
+    static constexpr XPilotAPIStrId NO_ID = 0xFFFFFFFF;
+
+    // Returns the id of the text, adding it to the pool if needed
+    static XPilotAPIStrId intern(std::string_view s);
+    // Returns the id of the text, NO_ID if not in the pool
+    static XPilotAPIStrId find(std::string_view s);
+    // Returns the text of an id, empty string for unknown ids
+    static const std::string& str(XPilotAPIStrId id);
+    // Number of distinct texts in the pool
+    static int size();
+};
+
+// One timestamped sample of an aircraft's position
+struct XPilotAPIPosSample
+{
+    std::chrono::steady_clock::time_point ts;   // time of fetching from xPilot
+    double lat      = 0.0;
+    double lon      = 0.0;
+    double alt_ft   = 0.0;
+    float heading   = 0.0f;
+    float speed_kt  = 0.0f;
+};
+
+// Fixed-capacity ring of position samples, oldest samples get overwritten
+class XPilotAPIHistory
+{
+public:
+    // Result of positionAt()
+    enum ResultTy {
+        POS_NONE = 0,           // no samples available
+        POS_OLDEST,             // requested time before the oldest sample, returns oldest sample
+        POS_INTERPOLATED,       // interpolated between two samples (or exactly one sample)
+        POS_EXTRAPOLATED,       // dead reckoning from the newest sample along heading with speed
+    };
+
+protected:
+    std::vector<XPilotAPIPosSample> vSamples;   // storage, size is the capacity
+    int head = 0;                               // index of the next sample to write
+    int count = 0;                              // number of valid samples
+
+public:
+    // Sets capacity, clears the history. 0 switches history off.
+    void setCapacity(int n);
+    int capacity() const { return (int)vSamples.size(); }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { head = count = 0; }
+
+    // Adds a sample, overwriting the oldest if full
+    void push(const XPilotAPIPosSample& s);
+    // Sample by age, `0` is the oldest, `size()-1` the newest
+    const XPilotAPIPosSample& at(int i) const
+    { return vSamples[size_t((head - count + i + capacity()) % capacity())]; }
+    const XPilotAPIPosSample& newest() const { return at(count - 1); }
+
+    // Position at time `t`: interpolated between samples, or extrapolated
+    // from the newest sample, but not more than `maxExtrapolation` into the future
+    ResultTy positionAt(std::chrono::steady_clock::time_point t, XPilotAPIPosSample& out,
+                        std::chrono::duration<double> maxExtrapolation = std::chrono::seconds(10)) const;
+};
+
+// Motion values derived from consecutive numerical records, smoothed over time
+struct XPilotAPIKinematics
+{
+    float vsi_fpm       = 0.0f;     // vertical speed (ft/min)
+    float turnRate_dps  = 0.0f;     // rate of heading change (deg/s, positive = right)
+    float track         = 0.0f;     // ground track (deg true), heading until the aircraft moved
+    float accel_kts     = 0.0f;     // longitudinal acceleration (knots/s)
+};
 
 class XPilotAPIAircraft
 {
 private:
-    unsigned keyNum = 0;
-    std::string key;
+    uint64_t keyNum = 0;
+    bool bHasKey = false;           // has `keyNum` been set by the first update?
+    mutable std::string key;        // hex string of `keyNum`, only built on first call to getKey()
 
 public:
     struct XPilotAPIBulkData {
@@ -95,6 +209,32 @@ public:
         XPilotAPIBulkInfoTexts() { memset(this, 0, sizeof(*this)); }
     };
 
+    // Flags telling which fields changed compared to the previous record, see getDirty()
+    enum DirtyFlags : uint32_t {
+        DIRTY_POS       = 0x00000001,   // lat, lon, alt_ft
+        DIRTY_ATTITUDE  = 0x00000002,   // heading, roll, pitch
+        DIRTY_SPEED     = 0x00000004,   // speed_kt
+        DIRTY_TERRAIN   = 0x00000008,   // terrainAlt_ft
+        DIRTY_CONFIG    = 0x00000010,   // flaps, gear
+        DIRTY_LIGHTS    = 0x00000020,   // any of the lights
+        DIRTY_GND       = 0x00000040,   // onGnd
+        DIRTY_MULTIIDX  = 0x00000080,   // multiIdx
+        DIRTY_CAMERA    = 0x00000100,   // bearing, dist_nm
+        DIRTY_BULK      = 0x0000FFFF,   // any of the above, i.e. any numerical field
+        DIRTY_CALLSIGN  = 0x00010000,   // callSign
+        DIRTY_MODEL     = 0x00020000,   // modelIcao, acClass, wtc
+        DIRTY_SQUAWK    = 0x00040000,   // squawk
+        DIRTY_ROUTE     = 0x00080000,   // origin, destination
+        DIRTY_CSL       = 0x00100000,   // cslModel
+        DIRTY_TEXT      = 0xFFFF0000,   // any of the above, i.e. any text field
+        DIRTY_ALL       = 0xFFFFFFFF,
+    };
+
+    // Compares two numerical records, returns combination of DIRTY_... flags
+    static uint32_t diff(const XPilotAPIBulkData& a, const XPilotAPIBulkData& b);
+    // Compares two text records, returns combination of DIRTY_... flags
+    static uint32_t diff(const XPilotAPIBulkInfoTexts& a, const XPilotAPIBulkInfoTexts& b);
+
     struct XPilotLights {
         bool beacon         : 1; // beacon lights
         bool strobe         : 1; // strobe lights
@@ -108,22 +248,50 @@ public:
 protected:
     XPilotAPIBulkData bulk;         // numerical plane data
     XPilotAPIBulkInfoTexts info;    // textual plane data
-    bool bUpdated = false;          // update helper, gets reset before updates, set during updates, stays false if not updated
+    // interned ids of repeated texts, see XPilotAPIStrPool
+    XPilotAPIStrId idModelIcao = 0;
+    XPilotAPIStrId idAcClass = 0;
+    XPilotAPIStrId idWtc = 0;
+    XPilotAPIStrId idOrigin = 0;
+    XPilotAPIStrId idDestination = 0;
+    mutable std::string description;    // cached result of getDescription()
+    mutable bool bDescrValid = false;   // is `description` up to date?
+    XPilotAPIHistory history;           // past positions, off unless XPilotAPIConnect::setHistoryCapacity() was called
+    XPilotAPIKinematics kin;            // derived motion values
+    bool bUpdated = false;          // update helper, set during updates, only reset by resetUpdated()
+    uint32_t dirty = DIRTY_ALL;     // DIRTY_... flags set by the last update of each kind
 
 public:
     XPilotAPIAircraft();
     virtual ~XPilotAPIAircraft();
 
+    // Resets the object to the state of a newly created object,
+    // called before a removed object is reused for a new aircraft.
+    // Derived classes with own state override this and call the base class.
+    virtual void recycle();
+
     // Updates the aircraft with fresh numerical values, called from XPilotAPIConnect::UpdateAcList()
     virtual bool updateAircraft(const XPilotAPIBulkData& __bulk, size_t __inSize);
     // Updates the aircraft with fresh textual information, called from XPilotAPIConnect::UpdateAcList()
     virtual bool updateAircraft(const XPilotAPIBulkInfoTexts& __info, size_t __inSize);
 
+    // Sets the capacity of the position history, 0 switches it off
+    void setHistoryCapacity(int n) { if (n != history.capacity()) history.setCapacity(n); }
+    // Adds the current position to the history, called from XPilotAPIConnect::UpdateAcList()
+    void addHistorySample(std::chrono::steady_clock::time_point ts);
+
+    // Sets derived motion values, called from XPilotAPIConnect::UpdateAcList()
+    void setKinematics(const XPilotAPIKinematics& _kin) { kin = _kin; }
+
     bool isUpdated()const { return bUpdated; }
     void resetUpdated() { bUpdated = false; }
+    // Which fields changed? DIRTY_BULK part refers to the last numerical update,
+    // DIRTY_TEXT part to the last text update
+    uint32_t getDirty() const { return dirty; }
 
 public:
-    std::string getKey()            const { return key; }
+    uint64_t getKeyNum()            const { return keyNum; }
+    std::string getKey()            const;
     std::string getCallSign()       const { return info.callSign; }
     std::string getAcClass()        const { return info.acClass; }
     std::string getWtc()            const { return info.wtc; }
@@ -132,7 +300,26 @@ public:
     std::string getSquawk()         const { return info.squawk; }
     std::string getOrigin()         const { return info.origin; }
     std::string getDestination()    const { return info.destination; }
-    std::string getDescription()    const;
+    // Description like "SWA916 (B737) KLAX-KJFK", cached until texts change
+    const std::string& getDescription() const;
+
+    // Text accessors without copying
+    std::string_view getKeyView()           const { return getKeyRef(); }
+    std::string_view getCallSignView()      const { return textView(info.callSign); }
+    std::string_view getAcClassView()       const { return textView(info.acClass); }
+    std::string_view getWtcView()           const { return textView(info.wtc); }
+    std::string_view getModelIcaoView()     const { return textView(info.modelIcao); }
+    std::string_view getCslModelView()      const { return textView(info.cslModel); }
+    std::string_view getSquawkView()        const { return textView(info.squawk); }
+    std::string_view getOriginView()        const { return textView(info.origin); }
+    std::string_view getDestinationView()   const { return textView(info.destination); }
+
+    // Interned ids of repeated texts, for comparing with XPilotAPIStrPool::find()
+    XPilotAPIStrId getModelIcaoId()     const { return idModelIcao; }
+    XPilotAPIStrId getAcClassId()       const { return idAcClass; }
+    XPilotAPIStrId getWtcId()           const { return idWtc; }
+    XPilotAPIStrId getOriginId()        const { return idOrigin; }
+    XPilotAPIStrId getDestinationId()   const { return idDestination; }
 
     // position, altitude
     double getLat()             const { return bulk.lat; }
@@ -151,8 +338,32 @@ public:
     float getDistNm()           const { return bulk.dist_nm; }
     int getMultiIdx()           const { return bulk.bits.multiIdx; }
 
+    // derived motion values, see XPilotAPIKinematics
+    const XPilotAPIKinematics& getKinematics() const { return kin; }
+    float getVSIFpm()           const { return kin.vsi_fpm; }
+    float getTurnRate()         const { return kin.turnRate_dps; }
+    float getTrack()            const { return kin.track; }
+    float getAccelKts()         const { return kin.accel_kts; }
+
+    // position history and position at a given time, see XPilotAPIHistory
+    const XPilotAPIHistory& getHistory() const { return history; }
+    XPilotAPIHistory::ResultTy positionAt(std::chrono::steady_clock::time_point t, XPilotAPIPosSample& out) const
+    { return history.positionAt(t, out); }
+
+    // complete records as last received
+    const XPilotAPIBulkData& getBulk()      const { return bulk; }
+    const XPilotAPIBulkInfoTexts& getInfo() const { return info; }
+
 public:
     static XPilotAPIAircraft* CreateNewObject() { return new XPilotAPIAircraft(); }
+
+protected:
+    // Returns the key string, building it on first request
+    const std::string& getKeyRef() const;
+    // View on a text field up to its zero termination
+    template <size_t N>
+    static std::string_view textView(const char (&field)[N])
+    { return std::string_view(field, size_t(std::find(field, field + N, '\0') - field)); }
 };
 
 // Smart pointer to an XPilotAPIAircraft object
@@ -164,6 +375,726 @@ typedef std::map<std::string, SPtrXPilotAPIAircraft> MapXPilotAPIAircraft;
 // Simple list of smart pointers to XPilotAPIAircraft objects
 typedef std::list<SPtrXPilotAPIAircraft> ListXPilotAPIAircraft;
 
+// Fields of xPilot's records, for use with XPilotAPIRecView
+//
+// Each field knows its record type, its value type, where it ends in the record
+// (to tell if xPilot's possibly shorter record contains it), and how to read it.
+namespace XPilotAPIField {
+
+#define XPILOTAPI_BULK_FIELD(name, member)                                  \
+    struct name {                                                           \
+        typedef XPilotAPIAircraft::XPilotAPIBulkData RecTy;                 \
+        typedef decltype(RecTy::member) ValueTy;                            \
+        static constexpr size_t end = offsetof(RecTy, member) + sizeof(ValueTy); \
+        static ValueTy get(const RecTy& r) { return r.member; }             \
+    };
+
+// bit fields: all in the first byte of `bits`, `multiIdx` in the second
+#define XPILOTAPI_BITS_FIELD(name, member, type, byte)                      \
+    struct name {                                                           \
+        typedef XPilotAPIAircraft::XPilotAPIBulkData RecTy;                 \
+        typedef type ValueTy;                                               \
+        static constexpr size_t end = offsetof(RecTy, bits) + byte + 1;     \
+        static ValueTy get(const RecTy& r) { return r.bits.member; }        \
+    };
+
+// text fields are read as views, which end at the first zero or the field's end
+#define XPILOTAPI_TEXT_FIELD(name, member)                                  \
+    struct name {                                                           \
+        typedef XPilotAPIAircraft::XPilotAPIBulkInfoTexts RecTy;            \
+        typedef std::string_view ValueTy;                                   \
+        static constexpr size_t end = offsetof(RecTy, member) + sizeof(RecTy::member); \
+        static ValueTy get(const RecTy& r)                                  \
+        { return ValueTy(r.member, size_t(std::find(r.member, r.member + sizeof(r.member), '\0') - r.member)); } \
+    };
+
+    XPILOTAPI_BULK_FIELD(Lat, lat)
+    XPILOTAPI_BULK_FIELD(Lon, lon)
+    XPILOTAPI_BULK_FIELD(AltFt, alt_ft)
+    XPILOTAPI_BULK_FIELD(Heading, heading)
+    XPILOTAPI_BULK_FIELD(Roll, roll)
+    XPILOTAPI_BULK_FIELD(Pitch, pitch)
+    XPILOTAPI_BULK_FIELD(SpeedKt, speed_kt)
+    XPILOTAPI_BULK_FIELD(TerrainAltFt, terrainAlt_ft)
+    XPILOTAPI_BULK_FIELD(Flaps, flaps)
+    XPILOTAPI_BULK_FIELD(Gear, gear)
+    XPILOTAPI_BULK_FIELD(Bearing, bearing)
+    XPILOTAPI_BULK_FIELD(DistNm, dist_nm)
+    XPILOTAPI_BITS_FIELD(OnGnd, onGnd, bool, 0)
+    XPILOTAPI_BITS_FIELD(TaxiLight, taxi, bool, 0)
+    XPILOTAPI_BITS_FIELD(LandingLight, land, bool, 0)
+    XPILOTAPI_BITS_FIELD(BeaconLight, bcn, bool, 0)
+    XPILOTAPI_BITS_FIELD(StrobeLight, strb, bool, 0)
+    XPILOTAPI_BITS_FIELD(NavLight, nav, bool, 0)
+    XPILOTAPI_BITS_FIELD(MultiIdx, multiIdx, int, 1)
+
+    XPILOTAPI_TEXT_FIELD(ModelIcao, modelIcao)
+    XPILOTAPI_TEXT_FIELD(AcClass, acClass)
+    XPILOTAPI_TEXT_FIELD(Wtc, wtc)
+    XPILOTAPI_TEXT_FIELD(CallSign, callSign)
+    XPILOTAPI_TEXT_FIELD(Squawk, squawk)
+    XPILOTAPI_TEXT_FIELD(Origin, origin)
+    XPILOTAPI_TEXT_FIELD(Destination, destination)
+    XPILOTAPI_TEXT_FIELD(CslModel, cslModel)
+
+#undef XPILOTAPI_BULK_FIELD
+#undef XPILOTAPI_BITS_FIELD
+#undef XPILOTAPI_TEXT_FIELD
+}
+
+// Read-only view of one chunk of fetched records, projected onto the fields `F...`
+//
+// Reads directly from the fetch buffer, nothing is copied. All fields must
+// belong to the same record type, and only declared fields can be read.
+// xPilot's records may be shorter than ours: fields xPilot doesn't provide
+// read as default values, has() tells which ones these are.
+// Longer records are cut to our size by xPilot already.
+// @note Valid only during the callback of XPilotAPIConnect::FetchView()
+template <class... F>
+class XPilotAPIRecView
+{
+public:
+    static_assert(sizeof...(F) >= 1 && sizeof...(F) <= 32, "A view needs 1 to 32 fields");
+    typedef typename std::tuple_element<0, std::tuple<F...>>::type::RecTy RecTy;
+    static_assert((std::is_same<RecTy, typename F::RecTy>::value && ...),
+                  "All fields of a view must belong to the same record type");
+
+protected:
+    const RecTy* pRec = nullptr;        // first record in the fetch buffer
+    int num = 0;                        // number of records
+    int first = 0;                      // position of the first record in xPilot's array
+    uint32_t availMask = 0;             // bit per field in `F...`: provided by xPilot?
+
+public:
+    XPilotAPIRecView(const RecTy* _pRec, int _num, int _first, int sizeXP) :
+        pRec(_pRec), num(_num), first(_first)
+    {
+        constexpr size_t aEnd[] = { F::end... };
+        for (size_t i = 0; i < sizeof...(F); i++)
+            if (sizeXP > 0 && aEnd[i] <= size_t(sizeXP))
+                availMask |= 1u << i;
+    }
+
+    // Number of records in this chunk
+    int size() const { return num; }
+    // Position of record 0 in xPilot's array
+    int getFirst() const { return first; }
+    // Key of record `i`, always available
+    uint64_t getKeyNum(int i) const { return pRec[i].keyNum; }
+
+    // Is field `G` provided by xPilot?
+    template <class G>
+    bool has() const
+    {
+        constexpr int idx = IndexOf<G>();
+        static_assert(idx >= 0, "Field not declared for this view");
+        return (availMask >> idx) & 1u;
+    }
+    // Are all declared fields provided by xPilot?
+    bool hasAll() const { return availMask == (~0u >> (32 - sizeof...(F))); }
+
+    // Value of field `G` of record `i`, default value if xPilot doesn't provide it
+    template <class G>
+    typename G::ValueTy get(int i) const
+    { return has<G>() ? G::get(pRec[i]) : typename G::ValueTy(); }
+
+protected:
+    template <class G>
+    static constexpr int IndexOf()
+    {
+        constexpr bool aIs[] = { std::is_same<G, F>::value... };
+        int idx = -1;
+        for (size_t i = 0; i < sizeof...(F); i++)
+            if (aIs[i] && idx < 0)
+                idx = int(i);
+        return idx;
+    }
+};
+
+// One change to an aircraft, reported by XPilotAPIConnect after an update
+struct XPilotAPIAcEvent
+{
+    XPilotAPIAircraft* pAc = nullptr;   // the aircraft, valid at least until the next update
+    uint64_t keyNum = 0;                // the aircraft's key
+    uint32_t dirty = 0;                 // XPilotAPIAircraft::DIRTY_... flags, compared to the previous record
+};
+
+// List of events
+typedef std::vector<XPilotAPIAcEvent> VecXPilotAPIAcEvent;
+
+// All changes of one update
+//
+// An aircraft is only listed in one of `added`, `removed`, or `posUpdated`.
+// Aircraft in `added` are not listed in `textChanged` in the same update.
+struct XPilotAPIChangeSet
+{
+    VecXPilotAPIAcEvent added;          // new aircraft, `dirty` is DIRTY_ALL
+    VecXPilotAPIAcEvent removed;        // aircraft no longer reported by xPilot
+    VecXPilotAPIAcEvent posUpdated;     // aircraft with changed numerical data, see DIRTY_BULK
+    VecXPilotAPIAcEvent textChanged;    // aircraft with changed texts, see DIRTY_TEXT
+    // Keeps removed aircraft alive until the next update
+    std::vector<SPtrXPilotAPIAircraft> vRemovedAc;
+
+    bool empty() const
+    { return added.empty() && removed.empty() && posUpdated.empty() && textChanged.empty(); }
+    void clear();
+};
+
+// A pair of aircraft within the conflict thresholds, see XPilotAPIConnect::enableConflicts()
+struct XPilotAPIConflict
+{
+    uint64_t keyA;                      // keys of both aircraft, `keyA < keyB`
+    uint64_t keyB;
+    float dist_nm;                      // current horizontal distance
+    float vertSep_ft;                   // current vertical separation
+    float tCPA_s;                       // time to closest point of approach, 0 if diverging
+    float distCPA_nm;                   // horizontal distance at closest point of approach
+};
+typedef std::vector<XPilotAPIConflict> VecXPilotAPIConflict;
+
+// Allocator returning memory aligned to a cache line, suitable for SIMD loads
+template <class T>
+struct XPilotAPIAlignedAlloc
+{
+    typedef T value_type;
+    static constexpr std::size_t alignment = 64;
+
+    XPilotAPIAlignedAlloc() noexcept {}
+    template <class U> XPilotAPIAlignedAlloc(const XPilotAPIAlignedAlloc<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignment))); }
+    void deallocate(T* p, std::size_t) noexcept
+    { ::operator delete(p, std::align_val_t(alignment)); }
+
+    template <class U> bool operator==(const XPilotAPIAlignedAlloc<U>&) const noexcept { return true; }
+    template <class U> bool operator!=(const XPilotAPIAlignedAlloc<U>&) const noexcept { return false; }
+};
+
+// Vector with cache-line aligned storage
+template <class T>
+using XPilotAPIAlignedVec = std::vector<T, XPilotAPIAlignedAlloc<T> >;
+
+// Distance and bearing of all aircraft from a reference point,
+// see XPilotAPIConnect::addRefPoint()
+struct XPilotAPIRefPoint
+{
+    int id = 0;
+    double lat = 0.0;
+    double lon = 0.0;
+    // Per aircraft, same indexes as XPilotAPIConnect::getAcStore(),
+    // moved along with the store when aircraft are removed
+    XPilotAPIAlignedVec<float> dist_nm;     // great circle distance
+    XPilotAPIAlignedVec<float> bearing;     // initial great circle bearing from the reference point
+};
+
+// Structure-of-arrays copy of all aircraft's numerical data
+//
+// Index `i` in all arrays refers to the same aircraft as index `i` in
+// XPilotAPIConnect::getAcStore(). Values are taken directly from the
+// fetched XPilotAPIBulkData records, so loops over these arrays
+// don't need to touch the aircraft objects at all.
+struct XPilotAPIFleetSoA
+{
+    // Flags in `bits`
+    enum : uint8_t {
+        BIT_ON_GND  = 0x01,         // is the plane on the ground?
+        BIT_TAXI    = 0x02,         // taxi lights
+        BIT_LAND    = 0x04,         // landing lights
+        BIT_BCN     = 0x08,         // beacon lights
+        BIT_STRB    = 0x10,         // strobe lights
+        BIT_NAV     = 0x20,         // navigation lights
+    };
+
+    XPilotAPIAlignedVec<uint64_t> keyNum;
+    XPilotAPIAlignedVec<double> lat;
+    XPilotAPIAlignedVec<double> lon;
+    XPilotAPIAlignedVec<double> alt_ft;
+    XPilotAPIAlignedVec<float> heading;
+    XPilotAPIAlignedVec<float> speed_kt;
+    XPilotAPIAlignedVec<float> dist_nm;
+    XPilotAPIAlignedVec<float> bearing;
+    XPilotAPIAlignedVec<uint8_t> bits;  // combination of BIT_... flags
+    XPilotAPIAlignedVec<int8_t> multiIdx;   // multiplayer slot, 0 if none
+    // derived values, see XPilotAPIKinematics
+    XPilotAPIAlignedVec<double> ts;     // time of last change in seconds of `steady_clock`, 0 if none yet
+    XPilotAPIAlignedVec<float> vsi_fpm;
+    XPilotAPIAlignedVec<float> turnRate_dps;
+    XPilotAPIAlignedVec<float> track;
+    XPilotAPIAlignedVec<float> accel_kts;
+
+    int size() const { return (int)keyNum.size(); }
+    bool empty() const { return keyNum.empty(); }
+
+    // Adds an entry for a new aircraft at the end
+    void push_back(uint64_t _keyNum);
+    // Copies values of a fetched record into index `i`
+    void set(int i, const XPilotAPIAircraft::XPilotAPIBulkData& bulk);
+    // Copies derived values into index `i`
+    void set(int i, double _ts, const XPilotAPIKinematics& kin);
+    // Removes index `i` by moving the last entry into it, like XPilotAPIAcStore::eraseAt()
+    void eraseAt(int i);
+    void clear();
+    void reserve(int n);
+};
+
+// Flat store of all aircraft, keyed by the numeric xPilot key
+//
+// Aircraft are kept in one contiguous vector (in no particular order),
+// an open-addressing hash table maps `keyNum` to the index in that vector.
+// Removing an aircraft moves the last aircraft into the freed index.
+class XPilotAPIAcStore
+{
+public:
+    typedef std::vector<SPtrXPilotAPIAircraft> VecTy;
+    typedef VecTy::const_iterator const_iterator;
+
+protected:
+    VecTy vAc;                          // contiguous list of aircraft
+    std::vector<uint64_t> vKeys;        // `keyNum` of the aircraft at the same index in `vAc`
+    std::vector<int> vHash;             // hash table, holds index into `vAc` plus 1, 0 means empty
+    unsigned hashShift = 64;            // right shift turning a hashed key into a table slot
+
+public:
+    int size() const { return (int)vAc.size(); }
+    bool empty() const { return vAc.empty(); }
+    const_iterator begin() const { return vAc.cbegin(); }
+    const_iterator end() const { return vAc.cend(); }
+    // Aircraft at a given index, `0 <= i < size()`
+    const SPtrXPilotAPIAircraft& operator[](int i) const { return vAc[size_t(i)]; }
+    // Key of the aircraft at a given index
+    uint64_t keyAt(int i) const { return vKeys[size_t(i)]; }
+
+    // Index of the aircraft with the given key, -1 if not found
+    int find(uint64_t keyNum) const;
+    // Aircraft with the given key, empty pointer if not found
+    SPtrXPilotAPIAircraft get(uint64_t keyNum) const;
+    // Adds an aircraft (key must not exist yet), returns its index
+    int insert(uint64_t keyNum, SPtrXPilotAPIAircraft&& pAc);
+    // Removes the aircraft at the given index, the last aircraft takes its place
+    void eraseAt(int i);
+    // Removes all aircraft
+    void clear();
+    // Prepare for at least `n` aircraft without rehashing
+    void reserve(int n);
+
+protected:
+    size_t hashSlot(uint64_t keyNum) const
+    { return size_t((keyNum * 0x9E3779B97F4A7C15ull) >> hashShift); }
+    void rehash(size_t numSlots);
+};
+
+// Filter and sort order of an XPilotAPIView, see XPilotAPIConnect::addView()
+//
+// All set conditions must match. Text conditions are interned ids,
+// see XPilotAPIStrPool::intern(), 0 matches any text.
+struct XPilotAPIQuery
+{
+    enum GndTy { GND_ANY = 0, GND_ONLY, AIR_ONLY };
+    enum SortTy { SORT_NONE = 0, SORT_DIST, SORT_ALT, SORT_SPEED, SORT_CALLSIGN };
+
+    GndTy gnd = GND_ANY;                // on ground, airborne, or both
+    double altMinFt = -std::numeric_limits<double>::infinity();
+    double altMaxFt = std::numeric_limits<double>::infinity();
+    float distMinNm = 0.0f;             // distance to the camera
+    float distMaxNm = std::numeric_limits<float>::infinity();
+    XPilotAPIStrId wtc = 0;             // wake turbulence category like "H"
+    XPilotAPIStrId acClass = 0;         // aircraft class like "L2J"
+    XPilotAPIStrId origin = 0;          // origin airport like "KLAX"
+    XPilotAPIStrId destination = 0;     // destination airport like "KJFK"
+
+    SortTy sortBy = SORT_NONE;          // SORT_NONE sorts by key
+    bool bDescending = false;
+    int topK = 0;                       // view only the first `topK` aircraft, 0 for all
+
+    // Does the aircraft match all conditions?
+    bool matches(const XPilotAPIAircraft& ac) const;
+    // XPilotAPIAircraft::DIRTY_... flags of fields conditions and sort order depend on
+    uint32_t getDirtyMask() const;
+};
+
+// Aircraft matching an XPilotAPIQuery, in sort order
+//
+// Maintained by XPilotAPIConnect from each update's change set:
+// only added, removed, and changed aircraft are evaluated again,
+// unless so many changed that sorting all again is cheaper.
+class XPilotAPIView
+{
+public:
+    struct EntryTy {
+        double val = 0.0;               // numerical sort value, negated if descending
+        uint64_t txt = 0;               // text sort value (first 8 characters), inverted if descending
+        uint64_t keyNum = 0;            // the aircraft's key, also breaks ties
+        XPilotAPIAircraft* pAc = nullptr;
+        bool operator<(const EntryTy& o) const
+        { return val < o.val || (val == o.val && (txt < o.txt || (txt == o.txt && keyNum < o.keyNum))); }
+    };
+
+protected:
+    int id = 0;
+    XPilotAPIQuery query;
+    uint32_t dirtyMask = 0;             // query.getDirtyMask()
+    std::vector<EntryTy> vEntries;      // all matching aircraft, sorted
+    std::unordered_map<uint64_t, EntryTy> mapEntries;  // the same entries by key
+    std::vector<uint64_t> vPrevKeys;    // scratch: visible keys before a rebuild
+    bool bChanged = true;               // did the visible part change with the last update?
+
+public:
+    XPilotAPIView(int _id, const XPilotAPIQuery& _query);
+
+    int getId() const { return id; }
+    const XPilotAPIQuery& getQuery() const { return query; }
+    // Number of aircraft in the view, at most `query.topK`
+    int size() const
+    { return query.topK > 0 && query.topK < int(vEntries.size()) ? query.topK : int(vEntries.size()); }
+    bool empty() const { return vEntries.empty(); }
+    // Number of all matching aircraft, also beyond `query.topK`
+    int getNumMatching() const { return int(vEntries.size()); }
+    // Aircraft at position `i`, `0 <= i < size()`, valid until the next update
+    XPilotAPIAircraft& operator[](int i) const { return *vEntries[size_t(i)].pAc; }
+    uint64_t keyAt(int i) const { return vEntries[size_t(i)].keyNum; }
+    // Did the aircraft in view or their order change with the last update?
+    bool isChanged() const { return bChanged; }
+
+    // Evaluates all aircraft, called from XPilotAPIConnect::addView()
+    void Rebuild(const XPilotAPIAcStore& store);
+    // Evaluates aircraft listed in `changes`, called from XPilotAPIConnect::UpdateAcStore()
+    void Apply(const XPilotAPIChangeSet& changes, const XPilotAPIAcStore& store);
+
+protected:
+    EntryTy MakeEntry(XPilotAPIAircraft* pAc) const;
+    // Re-evaluates one aircraft
+    void Update(XPilotAPIAircraft* pAc);
+    // Removes an entry from `vEntries` (not from `mapEntries`)
+    void Erase(const EntryTy& e);
+    // Adds an entry to `vEntries` and `mapEntries`
+    void Insert(const EntryTy& e);
+};
+
+// Geographic grid index over the positions of all aircraft
+//
+// The globe is divided into cells of `cellDeg` x `cellDeg` degrees.
+// Entries are indexes into XPilotAPIConnect::getAcStore() and follow the
+// same swap-with-last removal, so an entry never needs to be searched for.
+// The aircraft of a cell form a linked list through per-aircraft arrays,
+// so moving aircraft between cells never allocates.
+class XPilotAPIGeoIndex
+{
+public:
+    static constexpr int NO_CELL = -1;
+
+protected:
+    double cellDeg;                     // size of a cell in degrees
+    int numRows;                        // number of cell rows (latitude)
+    int numCols;                        // number of cell columns (longitude)
+    std::vector<int> vHead;             // per cell: first aircraft index, -1 if empty
+    std::vector<int> vCellOf;           // per aircraft index: cell id or NO_CELL
+    std::vector<int> vNext;             // per aircraft index: next aircraft in the same cell, -1 if last
+    std::vector<int> vPrev;             // per aircraft index: previous aircraft in the same cell, -1 if first
+
+public:
+    XPilotAPIGeoIndex(double _cellDeg = 0.5);
+
+    double getCellDeg() const { return cellDeg; }
+    int size() const { return (int)vCellOf.size(); }
+    // Reserves the per-aircraft arrays for `n` aircraft
+    void reserve(int n);
+
+    // Adds an entry for a new aircraft (not yet in any cell) at the end
+    void push_back();
+    // Sets position of aircraft `i`, moves it to another cell only if needed
+    void update(int i, double lat, double lon);
+    // Removes index `i` by moving the last entry into it, like XPilotAPIAcStore::eraseAt()
+    void eraseAt(int i);
+    void clear();
+
+    // Calls `f(idx)` for all aircraft in cells overlapping the given box
+    // @note Candidates only, callers need to check the actual position
+    template <class F>
+    void forEachInBox(double latMin, double latMax, double lonMin, double lonMax, F f) const;
+    // Calls `f(idx)` for all aircraft in cells at exactly `ring` cells distance from the cell of the given position
+    // @return `false` if the ring lies completely outside the globe, so that no further rings need to be searched
+    template <class F>
+    bool forEachInRing(double lat, double lon, int ring, F f) const;
+
+protected:
+    int rowOf(double lat) const;
+    int colOf(double lon) const;
+    int cellId(int row, int col) const { return row * numCols + col; }
+    // Removes index `i` from its current cell
+    void removeFromCell(int i);
+    // Calls `f(idx)` for all aircraft in a given cell, `col` is wrapped around
+    template <class F>
+    void forEachInCell(int row, int col, F f) const;
+};
+
+// Immutable copy of the fleet as of one update, see XPilotAPIConnect::getSnapshot()
+struct XPilotAPIFleetFrame
+{
+    uint32_t updateSeq = 0;             // update counter of the connection
+    std::chrono::steady_clock::time_point ts;   // time of publishing
+    // one record per aircraft, `vInfo[i]` belongs to the same aircraft as `vBulk[i]`
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkData> vBulk;
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkInfoTexts> vInfo;
+
+    int size() const { return (int)vBulk.size(); }
+};
+
+// Publishes fleet frames from the sim thread to any number of reader threads
+//
+// Neither readers nor the writer ever block: Each frame lives in a slot
+// with a reader count. Readers pin the current slot by incrementing its count
+// and re-checking that it is still current. The writer only refills slots
+// which are not current and have no readers; if there is none it adds a slot.
+// @note All handles must be released before the publisher is destroyed.
+class XPilotAPIFramePublisher
+{
+protected:
+    struct SlotTy {
+        XPilotAPIFleetFrame frame;
+        std::atomic<int> readers{ 0 };
+    };
+    std::vector<std::unique_ptr<SlotTy> > vSlots;  // only accessed by the writer
+    std::atomic<SlotTy*> pCurrent{ nullptr };       // latest published slot
+    SlotTy* pWriting = nullptr;                     // slot between beginWrite() and publish()
+
+public:
+    // Reference to a published frame, keeps it unchanged while held
+    class Handle {
+    protected:
+        SlotTy* pSlot = nullptr;
+    public:
+        Handle() {}
+        explicit Handle(SlotTy* _pSlot) : pSlot(_pSlot) {}
+        Handle(const Handle& o) : pSlot(o.pSlot) { if (pSlot) pSlot->readers++; }
+        Handle(Handle&& o) noexcept : pSlot(o.pSlot) { o.pSlot = nullptr; }
+        Handle& operator=(Handle o) noexcept { std::swap(pSlot, o.pSlot); return *this; }
+        ~Handle() { reset(); }
+        void reset() { if (pSlot) pSlot->readers--; pSlot = nullptr; }
+
+        explicit operator bool() const { return pSlot != nullptr; }
+        const XPilotAPIFleetFrame* get() const { return pSlot ? &pSlot->frame : nullptr; }
+        const XPilotAPIFleetFrame& operator*() const { return pSlot->frame; }
+        const XPilotAPIFleetFrame* operator->() const { return &pSlot->frame; }
+    };
+
+public:
+    // Reader: returns the latest published frame, empty handle if none yet. Thread-safe.
+    Handle acquire() const;
+    // Writer: returns a frame to fill, not visible to readers until publish()
+    XPilotAPIFleetFrame& beginWrite();
+    // Writer: makes the frame returned by beginWrite() the current frame
+    void publish();
+    // Writer: number of slots allocated so far
+    int getNumSlots() const { return (int)vSlots.size(); }
+};
+
+// Handle to a published fleet frame
+typedef XPilotAPIFramePublisher::Handle XPilotAPIFleetFrameHandle;
+
+// Histogram of durations with fixed, power-of-2 buckets in microseconds:
+// bucket 0 counts values below 1us, bucket i values in [2^(i-1), 2^i), the last one all larger values
+class XPilotAPIHistogram
+{
+public:
+    static constexpr int NUM_BUCKETS = 20;
+    std::array<uint64_t, NUM_BUCKETS> buckets = {};
+    uint64_t count = 0;
+    double sum_us = 0.0;
+    double max_us = 0.0;
+
+public:
+    void add(double us);
+    void clear() { *this = XPilotAPIHistogram(); }
+    double getMean() const { return count ? sum_us / double(count) : 0.0; }
+    // Upper bound of the bucket, in which the `p` quantile (0..1) falls
+    double getPercentile(double p) const;
+    // Upper bound of bucket `i` in microseconds
+    static double getBucketLimit(int i);
+};
+
+// Statistics of XPilotAPIConnect's updates
+//
+// Only collected if compiled with `XPILOTAPI_STATS` defined, otherwise all values stay zero.
+struct XPilotAPIStats
+{
+    // Phases of an update with own timing histogram
+    enum PhaseTy {
+        PHASE_AVAIL = 0,                // availability check and number of aircraft
+        PHASE_QUICK,                    // fetching numerical data
+        PHASE_EXPSV,                    // fetching texts
+        PHASE_REMOVAL,                  // removing aircraft which are gone
+        PHASE_TOTAL,                    // the entire update
+        NUM_PHASES
+    };
+    std::array<XPilotAPIHistogram, NUM_PHASES> phase;
+    uint64_t numUpdates = 0;            // number of updates
+    uint64_t numDatabCalls = 0;         // XPLMGetDatab calls, including size queries
+    uint64_t numDatabBytes = 0;         // record bytes delivered by xPilot
+    uint64_t numAcCreated = 0;          // aircraft created
+    uint64_t numAcRemoved = 0;          // aircraft removed
+    uint64_t numPosUpdated = 0;         // aircraft with changed numerical data
+    uint64_t numTextsChanged = 0;       // aircraft with changed texts
+
+    void clear() { *this = XPilotAPIStats(); }
+    static const char* getPhaseName(int ph);
+    // Are statistics collected in this build?
+#ifdef XPILOTAPI_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+};
+
+// Fleet frame shared by the connections of several plugins in one process
+//
+// Plain data only, as each plugin carries its own copy of this code.
+// Followed in memory by `capacity` XPilotAPIBulkData records, `capacity`
+// XPilotAPIBulkInfoTexts records, and `capacity` XPilotAPISharedStampTy,
+// by position in xPilot's arrays. The stamps tell which records were written
+// in which frame: texts in particular are only refreshed for some positions per frame.
+// The writer keeps `seq` odd while writing, readers retry if `seq` was odd or changed meanwhile.
+struct XPilotAPISharedStampTy
+{
+    uint64_t bulk;                      // frame in which the numerical record was written
+    uint64_t info;                      // frame in which the text record was written
+};
+
+struct XPilotAPISharedFleet
+{
+    std::atomic<uint32_t> seq;
+    uint32_t capacity;                  // number of records of each kind
+    int32_t numAc;                      // number of valid records
+    uint32_t numAcTotal;                // number of aircraft, more than `numAc` if `capacity` was too small
+    uint64_t frame;                     // incremented with each frame written
+    double ts;                          // time of the frame, seconds since the epoch
+
+    XPilotAPIAircraft::XPilotAPIBulkData* bulk()
+    { return reinterpret_cast<XPilotAPIAircraft::XPilotAPIBulkData*>(this + 1); }
+    XPilotAPIAircraft::XPilotAPIBulkInfoTexts* info()
+    { return reinterpret_cast<XPilotAPIAircraft::XPilotAPIBulkInfoTexts*>(bulk() + capacity); }
+    XPilotAPISharedStampTy* stamp()
+    { return reinterpret_cast<XPilotAPISharedStampTy*>(info() + capacity); }
+    const XPilotAPIAircraft::XPilotAPIBulkData* bulk() const
+    { return reinterpret_cast<const XPilotAPIAircraft::XPilotAPIBulkData*>(this + 1); }
+    const XPilotAPIAircraft::XPilotAPIBulkInfoTexts* info() const
+    { return reinterpret_cast<const XPilotAPIAircraft::XPilotAPIBulkInfoTexts*>(bulk() + capacity); }
+    const XPilotAPISharedStampTy* stamp() const
+    { return reinterpret_cast<const XPilotAPISharedStampTy*>(info() + capacity); }
+    // Were there more aircraft than fit into the region?
+    bool isTruncated() const { return numAcTotal > uint32_t(numAc); }
+    // Bytes needed for a region holding `cap` aircraft
+    static size_t getSize(uint32_t cap)
+    { return sizeof(XPilotAPISharedFleet) + cap * (sizeof(XPilotAPIAircraft::XPilotAPIBulkData) +
+                                                   sizeof(XPilotAPIAircraft::XPilotAPIBulkInfoTexts) +
+                                                   sizeof(XPilotAPISharedStampTy)); }
+};
+
+// Descriptor of the shared fleet, read from the provider's dataref `xpilotapi/shared/fleet`
+struct XPilotAPISharedDesc
+{
+    uint32_t magic;                     // MAGIC
+    uint32_t version;                   // VERSION, layout of XPilotAPISharedFleet
+    uint32_t sizeBulk;                  // sizeof(XPilotAPIBulkData) of the provider
+    uint32_t sizeInfo;                  // sizeof(XPilotAPIBulkInfoTexts) of the provider
+    const void* owner;                  // providing XPilotAPIConnect object
+    XPilotAPISharedFleet* pFleet;       // current region, can change when it grows
+    uint64_t frame;                     // last frame written
+
+    static constexpr uint32_t MAGIC = 0x58504146;      // "XPAF"
+    static constexpr uint32_t VERSION = 2;
+};
+
+// Header of the shared-memory region written by XPilotAPIShmExporter
+struct XPilotAPIShmHeader
+{
+    uint32_t magic;                     // MAGIC
+    uint32_t version;                   // VERSION, layout of this header and XPilotAPISharedFleet
+    uint32_t sizeBulk;                  // sizeof(XPilotAPIBulkData) of the writer
+    uint32_t sizeInfo;                  // sizeof(XPilotAPIBulkInfoTexts) of the writer
+    uint64_t totalSize;                 // size of the entire region in bytes
+    XPilotAPISharedFleet fleet;         // must be last: the records follow it
+
+    static constexpr uint32_t MAGIC = 0x58504153;      // "XPAS"
+    static constexpr uint32_t VERSION = 2;
+};
+
+// Exports each update's fleet into a named shared-memory region for other processes
+//
+// The region holds an XPilotAPIShmHeader followed by the records of all aircraft,
+// in the order of XPilotAPIConnect::getAcStore(), protected by the `seq` counter.
+// Use XPilotAPIShmReader to read it.
+class XPilotAPIShmExporter
+{
+protected:
+    std::string name;
+    XPilotAPIShmHeader* pHdr = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* hMapping = nullptr;
+#endif
+
+public:
+    XPilotAPIShmExporter() {}
+    XPilotAPIShmExporter(const XPilotAPIShmExporter&) = delete;
+    XPilotAPIShmExporter& operator=(const XPilotAPIShmExporter&) = delete;
+    ~XPilotAPIShmExporter() { close(); }
+
+    // Creates the region `_name` (like "/xpilotapi") for up to `capacity` aircraft.
+    // Further aircraft are left out, readers see that in `numAcTotal`.
+    bool open(const std::string& _name, uint32_t capacity = 4096);
+    // Unmaps and removes the region
+    void close();
+    bool isOpen() const { return pHdr != nullptr; }
+
+    // Writes all aircraft as the next frame, called from XPilotAPIConnect::UpdateAcList()
+    void write(const XPilotAPIAcStore& store);
+};
+
+// Reader of a region written by XPilotAPIShmExporter
+//
+// Reading in place without copies, giving up if the writer doesn't finish a frame:
+//     uint32_t seq;
+//     int tries = 0;
+//     do {
+//         seq = reader.beginRead();
+//         ...read from reader.getFleet()...
+//     } while (!reader.endRead(seq) && ++tries < 100);
+class XPilotAPIShmReader
+{
+protected:
+    XPilotAPIShmHeader* pHdr = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* hMapping = nullptr;
+#endif
+
+public:
+    XPilotAPIShmReader() {}
+    XPilotAPIShmReader(const XPilotAPIShmReader&) = delete;
+    XPilotAPIShmReader& operator=(const XPilotAPIShmReader&) = delete;
+    ~XPilotAPIShmReader() { close(); }
+
+    // Maps an existing region, fails if it doesn't exist or has an incompatible layout
+    bool open(const std::string& name);
+    void close();
+    bool isOpen() const { return pHdr != nullptr; }
+
+    const XPilotAPISharedFleet* getFleet() const { return pHdr ? &pHdr->fleet : nullptr; }
+    // Returns the counter to pass to endRead() without waiting.
+    // It is odd while a frame is being written, and stays odd if the writer died meanwhile.
+    uint32_t beginRead() const;
+    // Was the frame read since beginRead() consistent? Never for an odd counter.
+    bool endRead(uint32_t seq) const;
+    // Copies the latest consistent frame, `false` if none could be read in `maxTries` attempts.
+    // Each attempt that finds a frame being written counts.
+    // `pNumAcTotal` receives the number of aircraft including those that didn't fit.
+    bool read(std::vector<XPilotAPIAircraft::XPilotAPIBulkData>& vBulk,
+              std::vector<XPilotAPIAircraft::XPilotAPIBulkInfoTexts>& vInfo,
+              uint64_t& frame, double& ts, int maxTries = 100,
+              uint32_t* pNumAcTotal = nullptr) const;
+};
+
 class XPilotAPIConnect
 {
 public:
@@ -178,13 +1109,53 @@ public:
     // a new aircraft object.
     typedef XPilotAPIAircraft* fCreateAcObject();
 
+    // Callback function type passed in to subscribeChanges()
+    //
+    // Called at the end of UpdateAcStore()/UpdateAcList() if anything changed.
+    typedef void fChangeCallback(const XPilotAPIChangeSet& changes, void* refcon);
+
     // Number of seconds between two calls of the expensive type, which
     // fetches texts from xPilot
     std::chrono::seconds sPeriodExpsv = std::chrono::seconds(3);
 
+    // Reuse objects of removed aircraft for new aircraft?
+    // Enabled by default if objects are created by XPilotAPIAircraft::CreateNewObject.
+    // With own derived classes override XPilotAPIAircraft::recycle() before enabling.
+    // Objects are only reused if nobody else holds a pointer to them.
+    bool bRecycleAc = false;
+    // Maximum number of removed objects kept for reuse
+    int iAcPoolMax = 256;
+
+    // Time constant for smoothing derived motion values (vertical speed,
+    // turn rate, track, acceleration) in seconds
+    double kinSmoothingSec = 1.0;
+
+    // Staggered fetching of texts: Instead of fetching all texts every
+    // `sPeriodExpsv` seconds, each update fetches texts of new aircraft right
+    // away plus the texts of the next `iExpsvBudgetAc` aircraft in round-robin.
+    bool bStaggerExpsv = false;
+    // Number of aircraft per update to refresh texts for in staggered mode
+    int iExpsvBudgetAc = 20;
+
+    // Shared mode: a provider that hasn't published a new frame for this many seconds
+    // is considered stalled, consumers fetch from xPilot themselves until it resumes
+    double sharedTimeoutSec = 5.0;
+
+    // Pass as `numBulkAc` to XPilotAPIConnect() to size the bulk buffers automatically:
+    // they grow with the number of aircraft, so that each array is usually fetched in one call.
+    static constexpr int BULK_AC_AUTO = 0;
+    // Upper limit of the buffer size in automatic mode (number of aircraft)
+    int iBulkAcMax = 10000;
+
 protected:
+    // Size bulk buffers automatically?
+    const bool bAutoBulkAc = false;
     //  Number of aircraft to fetch in one bulk operation
-    const int iBulkAc = 50;
+    int iBulkAc = 50;
+    // Number of XPLMGetDatab calls fetching data in the last update
+    int numFetchCalls = 0;
+    // Number of record bytes fetched in the last update
+    size_t numFetchBytes = 0;
 
     // bulk data array for communication with xPilot
     std::unique_ptr<XPilotAPIAircraft::XPilotAPIBulkData[]> vBulkNum;
@@ -195,31 +1166,622 @@ protected:
 protected:
     // Pointer to callback function returning new aircraft objects
     fCreateAcObject* pfCreateAcObject = nullptr;
-    // The map of aircrafts
-    MapXPilotAPIAircraft mapAc;
+    // The store of aircraft, keyed by `keyNum`
+    XPilotAPIAcStore acStore;
+    // Map of aircraft for getAcMap(), built on first use and then
+    // maintained along with `acStore`, rebuilt lazily if `bMapDirty`
+    mutable MapXPilotAPIAircraft mapAc;
+    // Does `mapAc` need a rebuild from `acStore`?
+    mutable bool bMapDirty = false;
+    // Has getAcMap() been called, so that `mapAc` is to be maintained?
+    mutable bool bMapUsed = false;
+    // Map nodes of removed aircraft, reused for new aircraft
+    std::vector<MapXPilotAPIAircraft::node_type> vMapNodePool;
+    // Structure-of-arrays copy of numerical data, same order as `acStore`
+    XPilotAPIFleetSoA fleetSoA;
+    // Geographic index over aircraft positions, same indexes as `acStore`
+    XPilotAPIGeoIndex geoIndex;
+    // Index into `acStore` per multiplayer slot, -1 if no aircraft uses the slot
+    std::array<int, 128> aMultIdxAc;
+    // Update counter, incremented with every complete pass over xPilot's arrays
+    uint32_t updateSeq = 0;
+    // Per aircraft index: update counter of last numerical update and of creation
+    struct AcSeqTy {
+        uint32_t seen = 0;
+        uint32_t added = 0;
+        uint32_t posUpdated = 0;        // last pass listing the aircraft in `changes.posUpdated`
+    };
+    std::vector<AcSeqTy> vAcSeq;
+    // Number of aircraft with numerical data in the current pass
+    int numSeen = 0;
+    // State of the current pass over xPilot's arrays, may span several budgeted updates
+    struct PassTy {
+        bool bActive = false;           // pass started but not yet complete?
+        int numAc = 0;                  // number of aircraft at start of pass
+        bool bShifted = false;          // number of aircraft changed during the pass?
+        bool bNewAc = false;            // any new aircraft created during the pass?
+        int offQuick = 0;               // next position to fetch in the numerical array
+        int offExpsv = -1;              // next position to fetch in the text array, -1 if not yet decided
+        int expsvBudget = -1;           // staggered mode: aircraft left to refresh, -1 if not yet started
+    } pass;
+    // Changes of the last complete pass, collected over all calls of a budgeted pass
+    XPilotAPIChangeSet changes;
+    // Subscribers to changes
+    struct SubscriberTy {
+        int id;
+        fChangeCallback* pfCb;
+        void* refcon;
+    };
+    std::vector<SubscriberTy> vSubscribers;
+    int lastSubscriberId = 0;
+    // Publish fleet frames for reader threads?
+    bool bPublishFrames = false;
+    // Publisher of fleet frames for reader threads
+    XPilotAPIFramePublisher framePublisher;
+    // Update statistics, see XPilotAPIStats
+    XPilotAPIStats stats;
+    // Recorder of fetched records, if any
+    XPilotAPIRecorder* pRecorder = nullptr;
+    // Shared-memory exporter, if any
+    XPilotAPIShmExporter* pShmExporter = nullptr;
+    // Shared mode: use or provide a fleet shared by all connections in the process
+    bool bShared = false;
+    XPLMDataRef sharedDR = NULL;        // own dataref if we are the provider
+    XPilotAPISharedDesc sharedDesc = {};
+    std::unique_ptr<uint8_t[]> pSharedMem;  // provider: the region `sharedDesc.pFleet` points to
+    // provider: previous regions, consumers might still point to them until the frame is complete
+    std::vector<std::unique_ptr<uint8_t[]> > vSharedRetired;
+    XPLMDataRef sharedSrcDR = NULL;     // consumer: provider's dataref
+    uint64_t sharedFrameSeen = 0;       // consumer: last frame processed
+    uint64_t sharedFrameLast = 0;       // consumer: last frame the provider published
+    std::chrono::steady_clock::time_point tsSharedFrameLast;   // consumer: when `sharedFrameLast` changed
+    // consumer: copies of the shared records and their stamps
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkData> vSharedBulk;
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkInfoTexts> vSharedInfo;
+    std::vector<XPilotAPISharedStampTy> vSharedStamp;
+    static int SharedGetDesc(void* refcon, void* outValue, int inOffset, int inMaxLength);
+    // Conflict detection: thresholds, current pairs, rebuild all pairs next time?
+    bool bConflicts = false;
+    double conflictHorizNm = 5.0;
+    double conflictVertFt = 1000.0;
+    VecXPilotAPIConflict vConflicts;
+    bool bConflictsRebuild = false;
+    // Reference points for distance and bearing
+    std::list<XPilotAPIRefPoint> listRefPoints;
+    int lastRefPointId = 0;
+    // Filtered and sorted views
+    std::list<XPilotAPIView> listViews;
+    int lastViewId = 0;
+    // Scratch arrays for reference points: indexes of aircraft to recompute, their positions, results
+    std::vector<int> vRefChanged;
+    XPilotAPIAlignedVec<double> vRefLat, vRefLon;
+    XPilotAPIAlignedVec<float> vRefDist, vRefBrg;
+    // Scratch arrays for conflict detection
+    struct ConflictScratchTy {
+        std::vector<uint8_t> vMoved;    // per aircraft index: position changed in this update?
+        std::vector<int> vMovedIdx;     // indexes of moved aircraft
+        std::vector<int> vCand;         // candidate partners of one aircraft
+        XPilotAPIAlignedVec<double> lat, lon;
+        XPilotAPIAlignedVec<float> alt, trk, spd, dist, vsep, tcpa, dcpa;
+    } conflictScratch;
+    // Datarefs publishing `stats`, and what each of them returns
+    struct StatsDataRefTy {
+        XPLMDataRef dataRef = NULL;
+        const XPilotAPIStats* pStats = nullptr;
+        int phase = -1;                 // phase for histogram values, -1 for counters
+        int item = 0;                   // which value
+    };
+    std::list<StatsDataRefTy> listStatsDR;
+    // Dataref accessors for `listStatsDR`, `refcon` points to a StatsDataRefTy
+    static int StatsGeti(void* refcon);
+    static float StatsGetf(void* refcon);
+    static int StatsGetvi(void* refcon, int* outValues, int inOffset, int inMax);
     // Last fetching of expensive data
     std::chrono::time_point<std::chrono::steady_clock> lastExpsvFetch;
+    // Removed aircraft objects ready for reuse
+    std::vector<SPtrXPilotAPIAircraft> vAcPool;
+    // Staggered mode: position in xPilot's array to continue round-robin text refresh at
+    int expsvOffset = 0;
+    // Staggered mode: positions in xPilot's array of aircraft created during this update
+    std::vector<int> vNewAcPos;
+    // Capacity of each aircraft's position history, 0 if off
+    int historyCapacity = 0;
+    // Time the currently processed chunk was fetched
+    std::chrono::steady_clock::time_point tsChunk;
+    // Scratch arrays for processing one chunk of numerical records
+    struct ChunkScratchTy {
+        std::vector<int> vIdx;                      // index into `acStore`
+        std::vector<uint8_t> vNew;                  // is a new aircraft?
+        std::vector<XPilotAPIAircraft::XPilotAPIBulkData> vRec; // records cut to xPilot's record size
+        XPilotAPIAlignedVec<double> cLat, cLon, cAlt, pLat, pLon, pAlt, ts;
+        XPilotAPIAlignedVec<float> cHdg, cSpd, pHdg, pSpd, vsi, turn, track, accel;
+        void resize(int n);
+    } scratch;
 
 public:
     XPilotAPIConnect(fCreateAcObject* _pfCreateAcObject = XPilotAPIAircraft::CreateNewObject, int numBulkAc = 50);
     virtual ~XPilotAPIConnect();
-    // Is xPilot available? (checks via XPLMFindPluginBySignature)
+    // Is xPilot available with all required dataRefs? (see XPilotAPIBinding)
     static bool isXPilotAvail();
     // How many aircraft is xPilot displaying right now?
     static int getXPilotNumAc();
     // Does xPilot have control of AI planes?
     static bool doesXPilotControlAI();
+    // To be called from the plugin's XPluginReceiveMessage(),
+    // re-binds to xPilot when new dataRefs got registered (e.g. xPilot reloaded)
+    static void ReceivePluginMessage(XPLMPluginID inFrom, int inMsg, void* inParam);
+    // Updates the store of aircraft and returns reference to it
+    const XPilotAPIAcStore& UpdateAcStore(ListXPilotAPIAircraft* plistRemovedAc = nullptr);
     // Updates map of aircrafts and returns reference to them
     const MapXPilotAPIAircraft& UpdateAcList(ListXPilotAPIAircraft* plistRemovedAc = nullptr);
-    // Returns the map of aircraft
-    const MapXPilotAPIAircraft& getAcMap() const { return mapAc; }
+    // Fetches all of xPilot's numerical or text records, depending on the fields `F...`,
+    // and calls `fn(const XPilotAPIRecView<F...>&)` per chunk with a view of the fetch buffer.
+    // Aircraft objects and the store are not touched, so this is a light alternative
+    // to UpdateAcStore() for consumers needing only a few fields.
+    // @return Number of records passed to `fn`
+    template <class... F, class Fn>
+    int FetchView(Fn&& fn)
+    {
+        typedef XPilotAPIRecView<F...> ViewTy;
+        typedef typename std::remove_reference<Fn>::type FnTy;
+        return FetchRawChunks(std::is_same<typename ViewTy::RecTy, XPilotAPIAircraft::XPilotAPIBulkInfoTexts>::value,
+            [](const void* pRec, int num, int first, int sizeXP, void* refcon) {
+                (*static_cast<FnTy*>(refcon))(ViewTy(static_cast<const typename ViewTy::RecTy*>(pRec), num, first, sizeXP));
+            }, &fn);
+    }
+    // Updates the store of aircraft, but only fetches as many chunks as fit before `deadline`
+    // (at least one). The next call resumes where this one stopped.
+    // Aircraft are only removed at the end of a complete pass over xPilot's arrays.
+    // Changes are collected over the calls of a pass; conflicts, reference points,
+    // views, frames, and subscribers are only updated once the pass is complete.
+    // @return Has a pass been completed?
+    bool UpdateAcStoreBudgeted(std::chrono::steady_clock::time_point deadline,
+                               ListXPilotAPIAircraft* plistRemovedAc = nullptr);
+    // Is a budgeted pass in progress?
+    bool isPassActive() const { return pass.bActive; }
+    // Current number of aircraft fetched in one bulk operation
+    int getChunkSize() const { return iBulkAc; }
+    // Number of XPLMGetDatab calls fetching data in the last update
+    int getNumFetchCalls() const { return numFetchCalls; }
+    // Number of record bytes xPilot delivered in the last update
+    size_t getNumFetchBytes() const { return numFetchBytes; }
+    // Accumulated update statistics, only collected if compiled with `XPILOTAPI_STATS`
+    const XPilotAPIStats& getStats() const { return stats; }
+    void resetStats() { stats.clear(); }
+    // Shared mode: The first connection in the process with shared mode fetches from xPilot
+    // and provides its frames via the dataref `xpilotapi/shared/fleet`, all others
+    // process these frames instead of fetching themselves. If the provider goes away
+    // the next connection takes over.
+    void setShared(bool bEnable);
+    bool isShared() const { return bShared; }
+    bool isSharedProvider() const { return sharedDR != NULL; }
+    // Exports the fleet after each update to `pExp`, `nullptr` stops (not taking ownership)
+    void setShmExporter(XPilotAPIShmExporter* pExp) { pShmExporter = pExp; }
+    // Records all fetched records to `pRec`, `nullptr` stops recording (not taking ownership)
+    void setRecorder(XPilotAPIRecorder* pRec) { pRecorder = pRec; }
+    XPilotAPIRecorder* getRecorder() const { return pRecorder; }
+    // Publishes statistics as own read-only datarefs below `prefix`, like
+    // `<prefix>/quick/p99_us` or `<prefix>/ac_created`. Counters read as int stop
+    // at INT_MAX, read them as float for the full range. Does nothing without `XPILOTAPI_STATS`.
+    void publishStatsDataRefs(const char* prefix = "xpilotapi/stats");
+    void unpublishStatsDataRefs();
+    // Keep a history of the last `n` positions per aircraft, 0 switches history off
+    void setHistoryCapacity(int n);
+    int getHistoryCapacity() const { return historyCapacity; }
+    // Prepares for `n` aircraft: reserves memory and pre-creates objects for reuse
+    void reserveAc(int n);
+    // Number of objects ready for reuse
+    int getAcPoolSize() const { return (int)vAcPool.size(); }
+    // Returns the store of aircraft
+    const XPilotAPIAcStore& getAcStore() const { return acStore; }
+    // Returns the map of aircraft, keyed by the hex string key
+    // @note Compatibility view of getAcStore(), rebuilt on first access after aircraft were added or removed
+    const MapXPilotAPIAircraft& getAcMap() const;
+    // Returns the structure-of-arrays view of all aircraft's numerical data,
+    // index `i` refers to the same aircraft as `getAcStore()[i]`
+    const XPilotAPIFleetSoA& getFleetSoA() const { return fleetSoA; }
+    // Returns the changes of the last update, during a budgeted pass the changes collected so far
+    const XPilotAPIChangeSet& getLastChanges() const { return changes; }
+    // Registers a callback, which receives the changes after each update
+    // @return id to be passed to unsubscribeChanges()
+    int subscribeChanges(fChangeCallback* pfCb, void* refcon = nullptr);
+    // Removes a callback registered with subscribeChanges()
+    void unsubscribeChanges(int id);
+    // Enables publishing of an immutable fleet frame at the end of each update
+    void setPublishFrames(bool bPublish) { bPublishFrames = bPublish; }
+    bool isPublishingFrames() const { return bPublishFrames; }
+    // Returns the latest published fleet frame
+    // @note The only function of this class, which can be called from any thread
+    XPilotAPIFleetFrameHandle getSnapshot() const { return framePublisher.acquire(); }
+    // Find an aircraft by its numeric key
+    SPtrXPilotAPIAircraft getAcByKey(uint64_t keyNum) const { return acStore.get(keyNum); }
     // Find an aircraft for a given multiplayer slot
     SPtrXPilotAPIAircraft getAcByMultIdx(int multiIdx) const;
+    // Find the multiplayer slot of an aircraft given by its numeric key, 0 if none
+    int getMultIdxByKey(uint64_t keyNum) const;
 
+    // Returns indexes (into getAcStore() and getFleetSoA()) of all aircraft
+    // within `radiusNm` of the given position and within the given altitude band
+    void queryRadius(double lat, double lon, double radiusNm,
+                     std::vector<int>& vIdxOut,
+                     double altMinFt = -std::numeric_limits<double>::infinity(),
+                     double altMaxFt = std::numeric_limits<double>::infinity()) const;
+    // Returns indexes of all aircraft within the given box,
+    // `lonMin > lonMax` denotes a box crossing the antimeridian
+    void queryBox(double latMin, double latMax, double lonMin, double lonMax,
+                  std::vector<int>& vIdxOut,
+                  double altMinFt = -std::numeric_limits<double>::infinity(),
+                  double altMaxFt = std::numeric_limits<double>::infinity()) const;
+    // Returns indexes of the `k` aircraft closest to the given position, sorted by distance
+    void nearestK(double lat, double lon, int k, std::vector<int>& vIdxOut) const;
+
+    // Maintains pairs of aircraft closer than `horizNm` horizontally and `vertFt` vertically,
+    // updated with each update for aircraft which moved
+    void enableConflicts(double horizNm = 5.0, double vertFt = 1000.0);
+    void disableConflicts();
+    bool isConflictsEnabled() const { return bConflicts; }
+    // Current conflict pairs, in no particular order
+    const VecXPilotAPIConflict& getConflicts() const { return vConflicts; }
+
+    // Adds a reference point, for which distance and bearing of all aircraft
+    // are kept up to date with each update, returns its id
+    int addRefPoint(double lat, double lon);
+    // Moves a reference point, all values are recomputed
+    bool moveRefPoint(int id, double lat, double lon);
+    void removeRefPoint(int id);
+    // Values of a reference point, `nullptr` if unknown
+    const XPilotAPIRefPoint* getRefPoint(int id) const;
+
+    // Adds a view of all aircraft matching `query` in its sort order,
+    // kept up to date with each update, returns its id
+    int addView(const XPilotAPIQuery& query);
+    void removeView(int id);
+    // A view, `nullptr` if unknown
+    const XPilotAPIView* getView(int id) const;
 protected:
+    // Adds a new aircraft object for the given key, returns its index
+    int AddAc(uint64_t keyNum);
+    // Moves objects removed in the previous update into the pool if nobody else holds them
+    void RecycleRemovedAc();
+    // Removes the aircraft at the given index, optionally adding it to the list of removed aircraft
+    void RemoveAcAt(int i, ListXPilotAPIAircraft* plistRemovedAc);
+    // Removes all aircraft, optionally adding them to the list of removed aircraft
+    void RemoveAllAc(ListXPilotAPIAircraft* plistRemovedAc);
+    // Keep the compatibility map in step with the store once it is in use
+    void MapInsert(int idx);
+    void MapErase(int idx);
+    // Copies the current fleet into a new frame and publishes it
+    void PublishFrame();
+    // Maintains `aMultIdxAc` when aircraft at index `idx` changes from slot `oldSlot` to `newSlot`
+    void UpdateMultIdx(int idx, int oldSlot, int newSlot);
+
+    // Processes a chunk of fetched numerical records starting at position `first` in xPilot's array,
+    // returns if a new aircraft was created
+    bool ProcessChunk(const XPilotAPIAircraft::XPilotAPIBulkData* pBulk, int num, int first, int sizeXP);
+    // Processes a chunk of fetched text records, returns `false` as no aircraft is created from texts
+    bool ProcessChunk(const XPilotAPIAircraft::XPilotAPIBulkInfoTexts* pInfo, int num, int first, int sizeXP);
+    // Processes one fetched numerical record for the aircraft at index `idx`
+    void ProcessRecord(const XPilotAPIAircraft::XPilotAPIBulkData& bulk, int sizeXP, int idx, bool bNew);
+    // Processes one fetched text record, returns `false` as no aircraft is created from texts
+    bool ProcessRecord(const XPilotAPIAircraft::XPilotAPIBulkInfoTexts& info, int sizeXP);
+
+    // Fetches chunks from position `offset` up to `numAc`, advancing `offset` and `numChunks`,
+    // until done or `deadline` passed (after at least one chunk in total)
+    template <class T>
+    bool DoBulkFetch(int numAc, XPilotDataRef& DR, int& offset, int& numChunks,
+        std::chrono::steady_clock::time_point deadline,
+        std::unique_ptr<T[]>& vBulk);
+    // Fetches and processes `num` records (at most `iBulkAc`) starting at position `first`
     template <class T>
-    bool DoBulkFetch(int numAc, XPilotDataRef& DR, int& outSize, 
+    bool FetchChunk(XPilotDataRef& DR, int first, int num, int sizeXP,
         std::unique_ptr<T[]>& vBulk);
+    // Staggered mode: fetches texts of new aircraft and the next round-robin slice
+    // as far as `deadline` allows, returns if done for this pass
+    bool DoStaggeredExpsvFetch(int numAc, XPilotDataRef& DR, int& numChunks,
+        std::chrono::steady_clock::time_point deadline);
+    // Callback of FetchRawChunks(), `pRec` points to `num` records of our size
+    typedef void fRawChunkCallback(const void* pRec, int num, int first, int sizeXP, void* refcon);
+    // Fetches all numerical (or, if `bTexts`, all text) records chunk by chunk into the bulk buffers
+    // and passes each chunk to `pfCb`, returns the number of records fetched
+    int FetchRawChunks(bool bTexts, fRawChunkCallback* pfCb, void* refcon);
+    // Automatic mode: grows the bulk buffers to hold `numAc` aircraft
+    void SizeBulkBuffers(int numAc);
+    // Fetches from xPilot as far as `deadline` allows, returns if the pass is complete
+    bool DoFetch(std::chrono::steady_clock::time_point deadline, ListXPilotAPIAircraft* plistRemovedAc);
+    // Removes aircraft not seen in the current pass
+    void RemoveUnseenAc(ListXPilotAPIAircraft* plistRemovedAc, bool bShifted);
+    // Shared mode consumer: processes the provider's frame, `false` if there is no usable provider,
+    // `bProviderExists` tells if one exists at all (but is incompatible or stalled)
+    bool UpdateFromShared(ListXPilotAPIAircraft* plistRemovedAc, bool& bProviderExists);
+    // Shared mode provider: registration and writing of frames
+    void RegisterShared();
+    void UnregisterShared();
+    void SharedBegin(int numAc);
+    void SharedAdd(int first, const XPilotAPIAircraft::XPilotAPIBulkData* pBulk, int num, int sizeXP);
+    void SharedAdd(int first, const XPilotAPIAircraft::XPilotAPIBulkInfoTexts* pInfo, int num, int sizeXP);
+    void SharedEnd();
+    // Updates `vConflicts` for aircraft changed in this update
+    void UpdateConflicts();
+    // Recomputes values of all reference points for aircraft added or moved in this update
+    void UpdateRefPoints();
+    // Recomputes values of a reference point for the aircraft in `vRefChanged`
+    void UpdateRefPoint(XPilotAPIRefPoint& ref);
+    // Adds conflicts of aircraft `a` with partners in `conflictScratch.vCand`
+    void FindConflicts(int a);
+};
+
+// Access to X-Plane's plugin and dataRef functions
+//
+// All XPLM calls of this API go through the current backend.
+// By default that is this class, which calls the XPLM SDK.
+// Another backend can be installed with set(), e.g. XPilotAPISyntheticBackend
+// to run without X-Plane. Define XPILOTAPI_NO_XPLM to build without
+// linking to XPLM at all, the default backend then finds nothing.
+class XPilotAPIBackend
+{
+public:
+    virtual ~XPilotAPIBackend() {}
+
+    virtual XPLMPluginID    FindPluginBySignature(const char* inSignature);
+    virtual int             IsPluginEnabled(XPLMPluginID inPluginID);
+    virtual XPLMDataRef     FindDataRef(const char* inDataRefName);
+    virtual XPLMDataTypeID  GetDataRefTypes(XPLMDataRef inDataRef);
+    virtual int             GetDatai(XPLMDataRef inDataRef);
+    virtual float           GetDataf(XPLMDataRef inDataRef);
+    virtual int             GetDatab(XPLMDataRef inDataRef, void* outValue, int inOffset, int inMaxBytes);
+    virtual void            SetDatai(XPLMDataRef inDataRef, int inValue);
+    virtual void            SetDataf(XPLMDataRef inDataRef, float inValue);
+    // Registers an own read-only dataref, accessors not matching `inDataType` can be NULL
+    virtual XPLMDataRef     RegisterDataAccessor(const char* inDataName, XPLMDataTypeID inDataType,
+                                                 XPLMGetDatai_f inReadInt, XPLMGetDataf_f inReadFloat,
+                                                 XPLMGetDatavi_f inReadIntArray, XPLMGetDatab_f inReadData,
+                                                 void* inRefcon);
+    virtual void            UnregisterDataAccessor(XPLMDataRef inDataRef);
+
+public:
+    // The backend currently in use
+    static XPilotAPIBackend& get() { return *pCurr; }
+    // Installs a backend (not taking ownership), `nullptr` restores the XPLM backend
+    // @note Existing XPilotDataRef objects re-find their dataRefs on next use
+    static void set(XPilotAPIBackend* pBackend);
+    // Incremented with each call to set()
+    static unsigned getGeneration() { return generation; }
+
+protected:
+    static XPilotAPIBackend* pCurr;
+    static unsigned generation;
+};
+
+// Backend serving xPilot's datarefs from arrays in memory
+//
+// Serves `xpilot/num_aircraft`, `xpilot/ai_controlled`, `xpilot/bulk/quick`,
+// and `xpilot/bulk/expensive` from `vBulk` and `vInfo`, which derived classes fill.
+class XPilotAPIArrayBackend : public XPilotAPIBackend
+{
+protected:
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkData> vBulk;
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkInfoTexts> vInfo;
+    bool bXPilotAvail = true;           // simulate availability of xPilot
+
+public:
+    // Counters of GetDatab() calls, can be reset freely
+    long long numDatabCalls = 0;
+    long long numDatabBytes = 0;
+
+public:
+    int getNumAc() const { return (int)vBulk.size(); }
+    // Simulates xPilot being (un)available
+    void setXPilotAvail(bool bAvail) { bXPilotAvail = bAvail; }
+    void resetCounters() { numDatabCalls = numDatabBytes = 0; }
+
+    XPLMPluginID    FindPluginBySignature(const char* inSignature) override;
+    int             IsPluginEnabled(XPLMPluginID inPluginID) override;
+    XPLMDataRef     FindDataRef(const char* inDataRefName) override;
+    XPLMDataTypeID  GetDataRefTypes(XPLMDataRef inDataRef) override;
+    int             GetDatai(XPLMDataRef inDataRef) override;
+    float           GetDataf(XPLMDataRef inDataRef) override;
+    int             GetDatab(XPLMDataRef inDataRef, void* outValue, int inOffset, int inMaxBytes) override;
+    void            SetDatai(XPLMDataRef, int) override {}
+    void            SetDataf(XPLMDataRef, float) override {}
+    // Own datarefs are kept and served in memory
+    XPLMDataRef     RegisterDataAccessor(const char* inDataName, XPLMDataTypeID inDataType,
+                                         XPLMGetDatai_f inReadInt, XPLMGetDataf_f inReadFloat,
+                                         XPLMGetDatavi_f inReadIntArray, XPLMGetDatab_f inReadData,
+                                         void* inRefcon) override;
+    void            UnregisterDataAccessor(XPLMDataRef inDataRef) override;
+
+protected:
+    // dataRefs served, the handle is the index plus 1
+    enum DataRefTy { DR_NUM_AC = 1, DR_AI_CONTROLLED, DR_BULK_QUICK, DR_BULK_EXPSV, DR_OWN_FIRST = 100 };
+    // Own datarefs registered via RegisterDataAccessor(), handle is DR_OWN_FIRST plus index
+    struct OwnDataRefTy {
+        std::string name;               // empty if unregistered
+        XPLMDataTypeID type = xplmType_Unknown;
+        XPLMGetDatai_f fInt = NULL;
+        XPLMGetDataf_f fFloat = NULL;
+        XPLMGetDatavi_f fIntArray = NULL;
+        XPLMGetDatab_f fData = NULL;
+        void* refcon = nullptr;
+    };
+    std::vector<OwnDataRefTy> vOwnDR;
+    // Own dataref for a handle, `nullptr` if not an own dataref
+    const OwnDataRefTy* GetOwnDR(XPLMDataRef inDataRef) const;
+};
+
+// Backend serving synthetic xPilot traffic, for running the API without X-Plane
+//
+// Serves `numAc` aircraft flying around a center position,
+// which also acts as camera position for `bearing` and `dist_nm`.
+// step() moves the aircraft and replaces some of them according to `churnPerSec`.
+class XPilotAPISyntheticBackend : public XPilotAPIArrayBackend
+{
+public:
+    struct ConfigTy {
+        int numAc           = 100;      // number of aircraft
+        double centerLat    = 40.64;    // center of traffic (and camera position)
+        double centerLon    = -73.78;
+        double radiusNm     = 60.0;     // aircraft turn back towards the center beyond this distance
+        double churnPerSec  = 0.0;      // aircraft replaced by new ones per second
+        unsigned seed       = 1;        // seed for the pseudo-random generator
+    };
+
+protected:
+    ConfigTy cfg;
+    uint64_t nextKey = 0x100000;        // key for the next new aircraft
+    uint64_t rngState;                  // state of the pseudo-random generator
+    double churnDue = 0.0;              // fraction of an aircraft to be replaced
+
+public:
+    XPilotAPISyntheticBackend();
+    XPilotAPISyntheticBackend(const ConfigTy& _cfg);
+
+    const ConfigTy& getConfig() const { return cfg; }
+    // Changes the number of aircraft, adding or removing aircraft at the end
+    void setNumAc(int n);
+    void setChurnPerSec(double churn) { cfg.churnPerSec = churn; }
+    // Advances the simulation by `dtSec` seconds
+    void step(double dtSec);
+
+protected:
+    double rnd();                       // pseudo-random number in [0, 1)
+    // Initializes aircraft at index `i` as a new aircraft
+    void newAc(size_t i);
+};
+
+// Recording of fetched bulk records to a file for replay by XPilotAPIReplayBackend
+//
+// Each update is one frame with a timestamp and xPilot's number of aircraft.
+// Records are stored per position in xPilot's arrays as difference to the
+// previously recorded record at that position: only changed 4-byte words are written.
+// Every `keyframeInterval` frames a keyframe stores the full arrays, so that
+// replay can seek. An index of all frames is written on close().
+class XPilotAPIRecorder
+{
+public:
+    // Write a keyframe every this many frames
+    int keyframeInterval = 300;
+
+    // File layout
+    struct FileHeaderTy {
+        char magic[8];                  // "XPAPIREC"
+        uint32_t version;
+        uint32_t sizeBulk;              // sizeof(XPilotAPIBulkData) of the recording
+        uint32_t sizeInfo;              // sizeof(XPilotAPIBulkInfoTexts) of the recording
+        uint32_t reserved;
+        uint64_t numFrames;             // number of frames in the index
+        uint64_t indexOffset;           // file offset of the index, 0 if not closed properly
+    };
+    struct FrameHeaderTy {
+        uint32_t magic;                 // FRAME_MAGIC
+        uint32_t flags;                 // FRAME_KEY
+        double ts;                      // seconds since the epoch
+        int32_t numAc;                  // number of aircraft xPilot reported
+        uint32_t numBlocks;             // number of BlockHeaderTy following
+        uint64_t size;                  // bytes following this header up to the next frame
+    };
+    struct BlockHeaderTy {
+        uint8_t stream;                 // STREAM_BULK or STREAM_INFO
+        uint8_t bRaw;                   // full records instead of differences?
+        uint16_t reserved;
+        int32_t first;                  // first position in xPilot's array
+        int32_t num;                    // number of records
+    };
+    struct IndexEntryTy {
+        uint64_t offset;                // file offset of the frame
+        double ts;
+        uint32_t flags;
+        uint32_t reserved;
+    };
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t FRAME_MAGIC = 0x314D5246;     // "FRM1"
+    static constexpr uint32_t FRAME_KEY = 0x01;
+    enum StreamTy { STREAM_BULK = 0, STREAM_INFO, NUM_STREAMS };
+
+protected:
+    FILE* pFile = nullptr;
+    // Last recorded record per position and stream, reference for differences
+    std::array<std::vector<uint8_t>, NUM_STREAMS> aRef;
+    std::vector<uint8_t> vFrame;        // blocks of the current frame
+    FrameHeaderTy frameHdr = {};
+    bool bInFrame = false;
+    std::vector<IndexEntryTy> vIndex;
+    uint64_t fileOffset = 0;
+    bool bFailed = false;               // did writing fail? Then nothing more is written
+
+public:
+    XPilotAPIRecorder() {}
+    XPilotAPIRecorder(const XPilotAPIRecorder&) = delete;
+    XPilotAPIRecorder& operator=(const XPilotAPIRecorder&) = delete;
+    ~XPilotAPIRecorder() { close(); }
+
+    bool open(const std::string& path);
+    // Finishes the current frame, writes index and header.
+    // After a failed write only closes the file: without index the replay
+    // finds the frames written until then by walking them.
+    // @return `false` if any write failed
+    bool close();
+    bool isOpen() const { return pFile != nullptr; }
+    // Has writing failed since open()? The file then only holds the frames counted by getNumFrames()
+    bool hasFailed() const { return bFailed; }
+
+    // Called by XPilotAPIConnect during an update
+    void beginFrame(double ts, int numAc);
+    void addRecords(int first, const XPilotAPIAircraft::XPilotAPIBulkData* pBulk, int num);
+    void addRecords(int first, const XPilotAPIAircraft::XPilotAPIBulkInfoTexts* pInfo, int num);
+    void endFrame();
+
+    size_t getNumFrames() const { return vIndex.size(); }
+    uint64_t getNumBytes() const { return fileOffset; }
+
+    static size_t getRecSize(int stream);
+
+protected:
+    void addRecords(int stream, int first, const void* pRecs, int num);
+    void AddBlock(int stream, bool bRaw, int first, int num);
+};
+
+// Backend replaying a recording of XPilotAPIRecorder
+//
+// The file is memory-mapped (read into memory on Windows).
+// nextFrame() and seekFrame() put the aircraft of a frame in place, which are
+// then served like xPilot would. Replay speed is up to the caller.
+class XPilotAPIReplayBackend : public XPilotAPIArrayBackend
+{
+protected:
+    const uint8_t* pData = nullptr;     // file content
+    size_t dataLen = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> vFileData;     // file content if not mapped
+#endif
+    std::vector<XPilotAPIRecorder::IndexEntryTy> vIndex;
+    size_t currFrame = SIZE_MAX;        // frame currently in place, SIZE_MAX if none
+
+public:
+    XPilotAPIReplayBackend() { bXPilotAvail = false; }
+    XPilotAPIReplayBackend(const XPilotAPIReplayBackend&) = delete;
+    XPilotAPIReplayBackend& operator=(const XPilotAPIReplayBackend&) = delete;
+    ~XPilotAPIReplayBackend() override { close(); }
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return pData != nullptr; }
+
+    size_t getNumFrames() const { return vIndex.size(); }
+    double getFrameTs(size_t i) const { return i < vIndex.size() ? vIndex[i].ts : 0.0; }
+    // Frame currently in place, SIZE_MAX if none
+    size_t getCurrFrame() const { return currFrame; }
+    // Puts the next frame in place, `false` at the end
+    bool nextFrame();
+    // Puts frame `i` in place, starting from the nearest keyframe
+    bool seekFrame(size_t i);
+    // Puts the last frame at or before `ts` in place
+    bool seekTime(double ts);
+
+protected:
+    // Applies frame `i` to the arrays
+    bool ApplyFrame(size_t i);
+    // Builds the index by walking the frames if the file has none
+    bool ScanFrames(uint64_t offset);
 };
 
 class XPilotDataRef {
@@ -228,9 +1790,11 @@ protected:
     XPLMDataRef     dataRef = NULL;     // dataRef identifier returned by X-Plane
     XPLMDataTypeID  dataTypes = xplmType_Unknown;   // supported data types
     bool            bValid = true;      // does this object have a valid binding to a dataRef already?
+    unsigned        backendGen = 0;     // XPilotAPIBackend::getGeneration() when the dataRef was found
 public:
     XPilotDataRef(std::string _sDataRef);  // Constructor, set the dataRef's name
-    inline bool needsInit() const { return bValid && !dataRef; }
+    inline bool needsInit() const
+    { return (bValid && !dataRef) || backendGen != XPilotAPIBackend::getGeneration(); }
     // @brief Found the dataRef _and_ it contains formats we can work with?
     bool    isValid();
     // Finds the dataRef (and would try again and again, no matter what bValid says)
@@ -263,4 +1827,57 @@ public:
     void    set(float f);
 };
 
+// Cached binding to xPilot's plugin and its dataRefs
+//
+// Finds xPilot's plugin id and the `xpilot/*` dataRefs once and keeps them,
+// so that check() usually only asks if the plugin is still enabled.
+// The dataRefs are found again when xPilot gets enabled, when another
+// backend is installed, or after invalidate(). While xPilot isn't found,
+// is disabled, or lacks dataRefs the search is repeated at most every
+// `retryPeriod`, so that a reloaded xPilot is found under its new id.
+// @note Not thread-safe, to be used from the sim thread only.
+class XPilotAPIBinding {
+public:
+    enum StateTy {
+        NOT_FOUND = 0,      // xPilot's plugin not found
+        DISABLED,           // plugin found, but disabled
+        INCOMPATIBLE,       // plugin enabled, but required dataRefs missing
+        BOUND,              // plugin enabled and required dataRefs found
+    };
+
+    // Time between searches while xPilot isn't found, disabled, or incompatible
+    std::chrono::steady_clock::duration retryPeriod = std::chrono::seconds(2);
+
+    // xPilot's dataRefs, valid while BOUND
+    XPilotDataRef drNumAc       { "xpilot/num_aircraft" };
+    XPilotDataRef drAIControlled{ "xpilot/ai_controlled" };
+    XPilotDataRef drBulkQuick   { "xpilot/bulk/quick" };
+    XPilotDataRef drBulkExpsv   { "xpilot/bulk/expensive" };
+
+protected:
+    StateTy         state = NOT_FOUND;
+    XPLMPluginID    pluginId = XPLM_NO_PLUGIN_ID;
+    bool            bInvalid = true;    // find everything again with next check()
+    unsigned        backendGen = 0;     // XPilotAPIBackend::getGeneration() when bound
+    unsigned        generation = 0;     // incremented with each successful binding
+    std::chrono::steady_clock::time_point tNextRetry;
+
+public:
+    // The binding used by XPilotAPIConnect
+    static XPilotAPIBinding& get();
+    // Validates the binding, re-binding if needed, and returns the resulting state
+    StateTy check();
+    // Forces finding plugin and dataRefs again with the next check()
+    void invalidate() { bInvalid = true; }
+
+    StateTy getState() const { return state; }
+    XPLMPluginID getPluginId() const { return pluginId; }
+    // Changes whenever the binding is (re-)established, e.g. after xPilot reloaded
+    unsigned getGeneration() const { return generation; }
+
+protected:
+    // Finds xPilot's dataRefs, moves to BOUND or INCOMPATIBLE
+    void BindDataRefs(std::chrono::steady_clock::time_point now);
+};
+
 #endif // !XPilotAPI_h
@@ -0,0 +1,70 @@
+/*
+ * Compatibility map maintained along with the store under churn
+ */
+
+#include <set>
+
+#include "XPilotAPITest.h"
+
+// Same aircraft in the map as in the store, under the keys getKey() returns
+static bool MapMatchesStore(const XPilotAPIConnect& conn)
+{
+    const MapXPilotAPIAircraft& mapAc = conn.getAcMap();
+    const XPilotAPIAcStore& store = conn.getAcStore();
+    if ((int)mapAc.size() != store.size())
+        return false;
+    for (int i = 0; i < store.size(); i++) {
+        auto iter = mapAc.find(store[i]->getKey());
+        if (iter == mapAc.end() || iter->second != store[i])
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    XPilotAPISyntheticBackend::ConfigTy cfg;
+    cfg.numAc = 300;
+    cfg.churnPerSec = 100.0;
+    XPilotAPISyntheticBackend backend(cfg);
+    XPilotAPIBackendGuard guard(backend);
+
+    XPilotAPIConnect conn;
+    // the map is only maintained once used
+    for (int i = 0; i < 10; i++) {
+        backend.step(0.1);
+        conn.UpdateAcStore();
+    }
+    CHECK(MapMatchesStore(conn));
+
+    // churn: aircraft come and go
+    bool bOk = true;
+    for (int i = 0; i < 200; i++) {
+        backend.step(0.1);
+        conn.UpdateAcList();
+        bOk = bOk && MapMatchesStore(conn);
+    }
+    CHECK(bOk);
+
+    // the map doesn't keep removed objects from being recycled
+    backend.setNumAc(200);
+    conn.UpdateAcList();
+    conn.UpdateAcList();
+    CHECK(conn.getAcPoolSize() >= 100);
+    CHECK(MapMatchesStore(conn));
+
+    // all aircraft gone and back again
+    backend.setNumAc(0);
+    conn.UpdateAcList();
+    CHECK(conn.getAcMap().empty());
+    backend.setNumAc(50);
+    conn.UpdateAcList();
+    CHECK(MapMatchesStore(conn));
+    for (int i = 0; i < 20; i++) {
+        backend.step(0.1);
+        conn.UpdateAcList();
+    }
+    CHECK(MapMatchesStore(conn));
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+/*
+ * XPilotAPIAcStore and the connection's store compared with std containers
+ */
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "XPilotAPITest.h"
+
+// Random inserts, finds, and erases against std::unordered_map
+static void TestStore()
+{
+    XPilotAPIAcStore store;
+    std::unordered_map<uint64_t, XPilotAPIAircraft*> mapExp;
+    TestRnd rnd(1);
+
+    // small key range for many hits, high bits for keys sharing hash slots
+    auto randomKey = [&]() {
+        const uint64_t k = 1 + uint64_t(rnd() * 2000.0);
+        return rnd() < 0.5 ? k : k << 40;
+    };
+
+    bool bOk = true;
+    for (int op = 0; op < 200000; op++) {
+        const uint64_t key = randomKey();
+        const double r = rnd();
+        if (r < 0.45) {
+            if (mapExp.count(key) == 0) {
+                SPtrXPilotAPIAircraft pAc(XPilotAPIAircraft::CreateNewObject());
+                mapExp[key] = pAc.get();
+                const int idx = store.insert(key, std::move(pAc));
+                bOk = bOk && store.keyAt(idx) == key && store[idx].get() == mapExp[key];
+            }
+        }
+        else if (r < 0.85) {
+            const int idx = store.find(key);
+            if (idx >= 0) {
+                bOk = bOk && mapExp.count(key) == 1 && store.keyAt(idx) == key;
+                mapExp.erase(key);
+                store.eraseAt(idx);
+            }
+            else
+                bOk = bOk && mapExp.count(key) == 0;
+        }
+        else if (r < 0.9999) {
+            auto iter = mapExp.find(key);
+            bOk = bOk && store.get(key).get() == (iter == mapExp.end() ? nullptr : iter->second);
+        }
+        else {
+            store.clear();
+            mapExp.clear();
+        }
+
+        // full comparison from time to time
+        if (op % 5000 == 0) {
+            bOk = bOk && store.size() == (int)mapExp.size();
+            for (int i = 0; bOk && i < store.size(); i++)
+                bOk = store.find(store.keyAt(i)) == i && mapExp[store.keyAt(i)] == store[i].get();
+        }
+    }
+    CHECK(bOk);
+    CHECK(store.size() == (int)mapExp.size());
+    for (const auto& e : mapExp)
+        CHECK(store.get(e.first).get() == e.second);
+
+    // reserve doesn't lose entries
+    store.reserve(10000);
+    for (const auto& e : mapExp)
+        CHECK(store.get(e.first).get() == e.second);
+}
+
+// The connection's store holds exactly xPilot's aircraft, also with
+// aircraft added and removed at random positions between updates
+static void TestConnection()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    XPilotAPIConnect conn;
+    TestRnd rnd(2);
+    uint64_t nextKey = 1;
+
+    bool bOk = true;
+    for (int upd = 0; upd < 500; upd++) {
+        const int numAdd = int(rnd() * 20.0);
+        for (int i = 0; i < numAdd; i++)
+            backend.add(nextKey++, rnd() * 180.0 - 90.0, rnd() * 360.0 - 180.0);
+        const int numErase = int(rnd() * 20.0);
+        for (int i = 0; i < numErase && backend.getNumAc() > 0; i++)
+            backend.erase(size_t(rnd() * backend.getNumAc()));
+
+        conn.UpdateAcStore();
+        const XPilotAPIAcStore& store = conn.getAcStore();
+        std::set<uint64_t> setExp, setStore;
+        for (int i = 0; i < backend.getNumAc(); i++)
+            setExp.insert(backend.bulk(size_t(i)).keyNum);
+        for (int i = 0; i < store.size(); i++) {
+            setStore.insert(store.keyAt(i));
+            bOk = bOk && store[i]->getKeyNum() == store.keyAt(i) &&
+                  conn.getFleetSoA().keyNum[size_t(i)] == store.keyAt(i);
+        }
+        bOk = bOk && setStore == setExp && store.size() == (int)setExp.size();
+    }
+    CHECK(bOk);
+}
+
+int main()
+{
+    TestStore();
+    TestConnection();
+    return TEST_RESULT();
+}
@@ -0,0 +1,98 @@
+/*
+ * Binding to xPilot's plugin: found late, disabled, reloaded under a new id, and invalidated
+ */
+
+#include <chrono>
+#include <thread>
+
+#include "XPilotAPITest.h"
+
+// Backend whose xPilot plugin can come and go, and change its id
+class ReloadingBackend : public XPilotAPITestBackend
+{
+public:
+    XPLMPluginID id = XPLM_NO_PLUGIN_ID;
+    bool bEnabled = false;
+    bool bDataRefs = true;
+    int numFind = 0;                // calls to FindPluginBySignature()
+
+    XPLMPluginID FindPluginBySignature(const char*) override { numFind++; return id; }
+    int IsPluginEnabled(XPLMPluginID inPluginID) override { return bEnabled && inPluginID == id; }
+    XPLMDataRef FindDataRef(const char* inDataRefName) override
+    { return bDataRefs ? XPilotAPITestBackend::FindDataRef(inDataRefName) : NULL; }
+};
+
+static void WaitRetry(const XPilotAPIBinding& binding)
+{
+    std::this_thread::sleep_for(binding.retryPeriod + std::chrono::milliseconds(10));
+}
+
+int main()
+{
+    ReloadingBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    XPilotAPIBinding binding;
+    binding.retryPeriod = std::chrono::milliseconds(50);
+
+    // not found: searched again only after `retryPeriod`
+    CHECK(binding.check() == XPilotAPIBinding::NOT_FOUND);
+    CHECK(binding.check() == XPilotAPIBinding::NOT_FOUND);
+    CHECK(backend.numFind == 1);
+    backend.id = 1;
+    backend.bEnabled = true;
+    CHECK(binding.check() == XPilotAPIBinding::NOT_FOUND);
+    WaitRetry(binding);
+    CHECK(binding.check() == XPilotAPIBinding::BOUND);
+    CHECK(binding.getPluginId() == 1 && backend.numFind == 2);
+    const unsigned gen1 = binding.getGeneration();
+
+    // bound: no searching with every check
+    for (int i = 0; i < 10; i++)
+        binding.check();
+    CHECK(binding.getState() == XPilotAPIBinding::BOUND && backend.numFind == 2);
+
+    // disabled...
+    backend.bEnabled = false;
+    CHECK(binding.check() == XPilotAPIBinding::DISABLED);
+    const int numFindDisabled = backend.numFind;
+    CHECK(binding.check() == XPilotAPIBinding::DISABLED);
+    CHECK(backend.numFind == numFindDisabled);
+
+    // ...and reloaded under a new id: found with the next search, not before
+    backend.id = 2;
+    backend.bEnabled = true;
+    CHECK(binding.check() == XPilotAPIBinding::DISABLED);
+    WaitRetry(binding);
+    CHECK(binding.check() == XPilotAPIBinding::BOUND);
+    CHECK(binding.getPluginId() == 2 && binding.getGeneration() != gen1);
+
+    // unloaded while disabled, then loaded again, enabled only later
+    backend.bEnabled = false;
+    CHECK(binding.check() == XPilotAPIBinding::DISABLED);
+    backend.id = XPLM_NO_PLUGIN_ID;
+    WaitRetry(binding);
+    CHECK(binding.check() == XPilotAPIBinding::NOT_FOUND);
+    backend.id = 3;
+    WaitRetry(binding);
+    CHECK(binding.check() == XPilotAPIBinding::DISABLED);
+    CHECK(binding.getPluginId() == 3);
+    backend.bEnabled = true;
+    CHECK(binding.check() == XPilotAPIBinding::BOUND);
+
+    // invalidate(): plugin and dataRefs are searched again right away
+    const unsigned gen3 = binding.getGeneration();
+    const int numFindBound = backend.numFind;
+    binding.invalidate();
+    CHECK(binding.check() == XPilotAPIBinding::BOUND);
+    CHECK(backend.numFind == numFindBound + 1 && binding.getGeneration() != gen3);
+
+    // ...also finding dataRefs missing, until they show up
+    backend.bDataRefs = false;
+    binding.invalidate();
+    CHECK(binding.check() == XPilotAPIBinding::INCOMPATIBLE);
+    backend.bDataRefs = true;
+    WaitRetry(binding);
+    CHECK(binding.check() == XPilotAPIBinding::BOUND);
+
+    return TEST_RESULT();
+}
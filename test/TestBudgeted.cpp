@@ -0,0 +1,88 @@
+/*
+ * UpdateAcStoreBudgeted() spreading passes over several calls
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include "XPilotAPITest.h"
+
+static int gNumCallbacks = 0;
+static size_t gNumAdded = 0;
+
+static void OnChanges(const XPilotAPIChangeSet& changes, void*)
+{
+    gNumCallbacks++;
+    gNumAdded += changes.added.size();
+}
+
+// Values of aircraft added during a pass are only computed at its end
+static bool NoDistances(const XPilotAPIRefPoint& ref)
+{
+    return std::all_of(ref.dist_nm.begin(), ref.dist_nm.end(), [](float d) { return d == 0.0f; });
+}
+
+int main()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    for (uint64_t key = 1; key <= 500; key++)
+        backend.add(key, 40.0 + key * 0.001, -74.0, 5000.0, "CS");
+
+    XPilotAPIConnect conn(XPilotAPIAircraft::CreateNewObject, 50);
+    conn.bStaggerExpsv = true;
+    conn.iExpsvBudgetAc = 120;
+    conn.setPublishFrames(true);
+    conn.subscribeChanges(OnChanges);
+    const int ref = conn.addRefPoint(40.0, -74.0);
+    XPilotAPIQuery q;
+    const int view = conn.addView(q);
+
+    // a deadline in the past: one chunk per call
+    const auto past = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    int numCalls = 0;
+    bool bOneChunk = true, bNothingEarly = true;
+    while (!conn.UpdateAcStoreBudgeted(past)) {
+        numCalls++;
+        bOneChunk = bOneChunk && conn.getNumFetchCalls() <= 1;
+        bNothingEarly = bNothingEarly && gNumCallbacks == 0 && !conn.getSnapshot() &&
+                        conn.getView(view)->size() == 0 && NoDistances(*conn.getRefPoint(ref));
+    }
+    numCalls++;
+    CHECK(bOneChunk);
+    CHECK(bNothingEarly);
+    // 10 chunks of numerical data, 10 chunks with the texts of new aircraft,
+    // 3 chunks refreshing texts round-robin
+    CHECK(numCalls == 10 + 10 + 3);
+
+    // all changes of the pass arrive together
+    CHECK(gNumCallbacks == 1);
+    CHECK(gNumAdded == 500);
+    CHECK(conn.getLastChanges().added.size() == 500);
+    CHECK(conn.getSnapshot() && conn.getSnapshot()->size() == 500);
+    CHECK(conn.getView(view)->size() == 500);
+    CHECK(conn.getRefPoint(ref)->dist_nm.size() == 500);
+    CHECK(conn.getAcStore().get(1)->getInfo().callSign == std::string("CS"));
+
+    // next pass: round-robin refresh of 120 texts resumes across calls, too
+    for (int i = 0; i < backend.getNumAc(); i++)
+        backend.bulk(size_t(i)).lat += 0.01;
+    numCalls = 0;
+    bOneChunk = true;
+    while (!conn.UpdateAcStoreBudgeted(past)) {
+        numCalls++;
+        bOneChunk = bOneChunk && conn.getNumFetchCalls() <= 1;
+    }
+    numCalls++;
+    CHECK(bOneChunk);
+    CHECK(numCalls == 10 + 3);
+    CHECK(gNumCallbacks == 2);
+    // every aircraft listed once
+    CHECK(conn.getLastChanges().posUpdated.size() == 500);
+    CHECK(conn.getLastChanges().added.empty());
+
+    // without a budget a pass completes in one call
+    CHECK(conn.UpdateAcStoreBudgeted(std::chrono::steady_clock::time_point::max()));
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+/*
+ * Incremental conflict detection compared with brute force
+ */
+
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "XPilotAPITest.h"
+
+typedef std::pair<uint64_t, uint64_t> PairTy;
+
+constexpr double HORIZ_NM = 5.0;
+constexpr double VERT_FT = 1000.0;
+// pairs this close to a threshold may go either way with float math
+constexpr double EPS_NM = 0.001;
+constexpr double EPS_FT = 0.01;
+
+// Compares the connection's conflicts with all pairs of the backend's aircraft
+static bool MatchesBruteForce(const XPilotAPIConnect& conn, XPilotAPITestBackend& backend)
+{
+    std::set<PairTy> setFound;
+    for (const XPilotAPIConflict& c : conn.getConflicts()) {
+        if (c.keyA >= c.keyB || !setFound.insert({ c.keyA, c.keyB }).second)
+            return false;                               // unordered or duplicate pair
+        const XPilotAPIAircraft* pA = conn.getAcStore().get(c.keyA).get();
+        const XPilotAPIAircraft* pB = conn.getAcStore().get(c.keyB).get();
+        if (!pA || !pB)
+            return false;
+        const double dist = TestDistNm(pA->getLat(), pA->getLon(), pB->getLat(), pB->getLon());
+        const double vsep = std::abs(pA->getAltFt() - pB->getAltFt());
+        if (dist > HORIZ_NM + EPS_NM || vsep > VERT_FT + EPS_FT ||
+            std::abs(c.dist_nm - dist) > 0.01 || std::abs(c.vertSep_ft - vsep) > 0.5 || c.tCPA_s < 0.0f)
+            return false;
+    }
+
+    for (int i = 0; i < backend.getNumAc(); i++)
+        for (int j = i + 1; j < backend.getNumAc(); j++) {
+            const auto& a = backend.bulk(size_t(i));
+            const auto& b = backend.bulk(size_t(j));
+            if (TestDistNm(a.lat, a.lon, b.lat, b.lon) < HORIZ_NM - EPS_NM &&
+                std::abs(a.alt_ft - b.alt_ft) < VERT_FT - EPS_FT &&
+                !setFound.count({ std::min(a.keyNum, b.keyNum), std::max(a.keyNum, b.keyNum) }))
+                return false;
+        }
+    return true;
+}
+
+int main()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    TestRnd rnd(17);
+
+    // dense clusters, one across the antimeridian, one close to the pole
+    const std::vector<std::pair<double, double> > vCenters = {
+        { 40.6, -73.8 }, { 0.0, 180.0 }, { 89.9, 0.0 }, { -33.9, 151.2 }
+    };
+    uint64_t nextKey = 1;
+    auto addAc = [&]() {
+        const auto& c = vCenters[size_t(rnd() * double(vCenters.size()))];
+        const double lat = std::min(90.0, c.first + (rnd() - 0.5) * 0.4);
+        double lon = c.second + (rnd() - 0.5) * 0.4 / std::max(0.05, std::cos(lat * 3.14159265358979 / 180.0));
+        while (lon >= 180.0) lon -= 360.0;
+        while (lon < -180.0) lon += 360.0;
+        backend.add(nextKey++, lat, lon, 3000.0 + rnd() * 6000.0);
+    };
+    for (int i = 0; i < 200; i++)
+        addAc();
+
+    XPilotAPIConnect conn;
+    conn.UpdateAcStore();
+    conn.enableConflicts(HORIZ_NM, VERT_FT);
+    CHECK(!conn.getConflicts().empty());
+    CHECK(MatchesBruteForce(conn, backend));
+
+    bool bOk = true;
+    for (int upd = 0; upd < 100; upd++) {
+        // some aircraft move, some only climb or descend, some turn only
+        for (int i = 0; i < backend.getNumAc(); i++) {
+            auto& b = backend.bulk(size_t(i));
+            const double r = rnd();
+            if (r < 0.2) {
+                b.lat = std::max(-90.0, std::min(90.0, b.lat + (rnd() - 0.5) * 0.05));
+                b.lon += (rnd() - 0.5) * 0.05;
+                if (b.lon >= 180.0) b.lon -= 360.0;
+                if (b.lon < -180.0) b.lon += 360.0;
+            }
+            else if (r < 0.3)
+                b.alt_ft += (rnd() - 0.5) * 1000.0;
+            else if (r < 0.35)
+                b.heading = float(rnd() * 360.0);
+        }
+        // some come, some go
+        for (int i = int(rnd() * 5.0); i > 0; i--)
+            addAc();
+        for (int i = int(rnd() * 5.0); i > 0 && backend.getNumAc() > 0; i--)
+            backend.erase(size_t(rnd() * backend.getNumAc()));
+
+        conn.UpdateAcStore();
+        bOk = bOk && MatchesBruteForce(conn, backend);
+    }
+    CHECK(bOk);
+
+    // new thresholds rebuild all pairs
+    conn.enableConflicts(2.0, 500.0);
+    for (const XPilotAPIConflict& c : conn.getConflicts())
+        CHECK(c.dist_nm <= 2.0f && c.vertSep_ft <= 500.0f);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,119 @@
+/*
+ * XPilotAPIFramePublisher with one writer thread and several reader threads
+ */
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "XPilotAPITest.h"
+
+constexpr int NUM_READERS = 4;
+constexpr uint32_t MIN_FRAMES = 50000;
+constexpr long long MIN_READS = 50000;
+
+// Frames held by readers, counted by the readers themselves
+static std::mutex gHeldMutex;
+static std::map<const XPilotAPIFleetFrame*, int> gHeld;
+
+static void SetHeld(const XPilotAPIFleetFrame* pFrame, int delta)
+{
+    std::lock_guard<std::mutex> lock(gHeldMutex);
+    gHeld[pFrame] += delta;
+}
+
+static bool IsHeld(const XPilotAPIFleetFrame* pFrame)
+{
+    std::lock_guard<std::mutex> lock(gHeldMutex);
+    auto iter = gHeld.find(pFrame);
+    return iter != gHeld.end() && iter->second > 0;
+}
+
+// Each frame's size and all its records derive from its sequence number
+static int FrameSize(uint32_t seq) { return int(seq % 37) + 1; }
+
+static bool IsConsistent(const XPilotAPIFleetFrame& frame)
+{
+    const uint32_t seq = frame.updateSeq;
+    if (frame.size() != FrameSize(seq) || frame.vInfo.size() != frame.vBulk.size())
+        return false;
+    for (int i = 0; i < frame.size(); i++)
+        if (frame.vBulk[size_t(i)].keyNum != uint64_t(seq) * 100 + uint64_t(i) ||
+            frame.vBulk[size_t(i)].lat != double(seq) ||
+            frame.vInfo[size_t(i)].keyNum != uint64_t(seq) * 100 + uint64_t(i))
+            return false;
+    return true;
+}
+
+int main()
+{
+    XPilotAPIFramePublisher publisher;
+    std::atomic<bool> bDone(false);
+    std::atomic<int> numTorn(0), numChangedWhileHeld(0), numBackwards(0), numReusedHeld(0);
+    std::atomic<long long> numReads(0);
+
+    std::vector<std::thread> vReaders;
+    for (int r = 0; r < NUM_READERS; r++) {
+        vReaders.emplace_back([&, r]() {
+            TestRnd rnd(uint64_t(r) + 10);
+            uint32_t lastSeq = 0;
+            while (!bDone.load()) {
+                XPilotAPIFleetFrameHandle h = publisher.acquire();
+                if (!h)
+                    continue;
+                SetHeld(h.get(), 1);
+                const uint32_t seq = h->updateSeq;
+                if (!IsConsistent(*h))
+                    numTorn++;
+                if (seq < lastSeq)
+                    numBackwards++;
+                lastSeq = seq;
+
+                // hold the frame for a while, also across copies of the handle
+                XPilotAPIFleetFrameHandle h2 = h;
+                const int spin = int(rnd() * 2000.0);
+                for (volatile int i = 0; i < spin; i = i + 1) {}
+                if (rnd() < 0.05)
+                    std::this_thread::yield();
+                if (h2->updateSeq != seq || !IsConsistent(*h2))
+                    numChangedWhileHeld++;
+                SetHeld(h.get(), -1);
+                numReads++;
+            }
+        });
+    }
+
+    // writer, until the readers have had their share
+    uint32_t seq = 0;
+    while (++seq <= MIN_FRAMES || numReads < MIN_READS) {
+        XPilotAPIFleetFrame& frame = publisher.beginWrite();
+        if (IsHeld(&frame))
+            numReusedHeld++;
+        frame.updateSeq = seq;
+        frame.vBulk.resize(size_t(FrameSize(seq)));
+        frame.vInfo.resize(size_t(FrameSize(seq)));
+        for (int i = 0; i < FrameSize(seq); i++) {
+            frame.vBulk[size_t(i)].keyNum = uint64_t(seq) * 100 + uint64_t(i);
+            frame.vBulk[size_t(i)].lat = double(seq);
+            frame.vInfo[size_t(i)].keyNum = uint64_t(seq) * 100 + uint64_t(i);
+        }
+        publisher.publish();
+    }
+    bDone = true;
+    for (std::thread& t : vReaders)
+        t.join();
+
+    CHECK(numTorn == 0);
+    CHECK(numChangedWhileHeld == 0);
+    CHECK(numBackwards == 0);
+    CHECK(numReusedHeld == 0);
+    CHECK(numReads > 0);
+    // each reader pins at most one slot at a time, plus the current one and the one being written
+    CHECK(publisher.getNumSlots() <= NUM_READERS + 2);
+    CHECK(publisher.acquire()->updateSeq == seq - 1);
+    printf("%u frames, %lld reads, %d slots\n", seq - 1, numReads.load(), publisher.getNumSlots());
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,104 @@
+/*
+ * Radius, box and nearest-k queries compared with brute force
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "XPilotAPITest.h"
+
+// Query points all over the globe, plus the antipodes of the fleet's clusters
+static std::vector<std::pair<double, double> > QueryPoints(const std::vector<std::pair<double, double> >& vCenters)
+{
+    std::vector<std::pair<double, double> > vPts;
+    for (double lat = -90.0; lat <= 90.0; lat += 15.0)
+        for (double lon = -180.0; lon < 180.0; lon += 22.5)
+            vPts.emplace_back(lat, lon);
+    for (const auto& c : vCenters) {
+        vPts.emplace_back(-c.first, c.second > 0.0 ? c.second - 180.0 : c.second + 180.0);
+        vPts.emplace_back(c.first, c.second);
+    }
+    return vPts;
+}
+
+int main()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+
+    // clusters near the poles, at the antimeridian, and in between, plus scattered aircraft
+    const std::vector<std::pair<double, double> > vCenters = {
+        { 40.0, -74.0 }, { -33.9, 151.2 }, { 0.0, 179.8 }, { 0.0, -179.8 }, { 89.5, 10.0 }, { -89.5, -120.0 }, { 51.5, 0.0 }
+    };
+    TestRnd rnd(3);
+    uint64_t key = 1;
+    for (const auto& c : vCenters)
+        for (int i = 0; i < 30; i++) {
+            const double lat = std::max(-90.0, std::min(90.0, c.first + (rnd() - 0.5) * 2.0));
+            double lon = c.second + (rnd() - 0.5) * 2.0;
+            if (lon >= 180.0) lon -= 360.0;
+            if (lon < -180.0) lon += 360.0;
+            backend.add(key++, lat, lon, rnd() * 40000.0);
+        }
+    for (int i = 0; i < 200; i++)
+        backend.add(key++, rnd() * 180.0 - 90.0, rnd() * 360.0 - 180.0, rnd() * 40000.0);
+
+    XPilotAPIConnect conn;
+    conn.UpdateAcStore();
+    const XPilotAPIFleetSoA& soa = conn.getFleetSoA();
+    const int n = conn.getAcStore().size();
+    CHECK(n == int(key - 1));
+
+    std::vector<int> vIdx;
+    for (const auto& pt : QueryPoints(vCenters)) {
+        const double lat = pt.first, lon = pt.second;
+
+        // radius with altitude band
+        for (double radius : { 10.0, 150.0, 2000.0, 11000.0 }) {
+            conn.queryRadius(lat, lon, radius, vIdx, 1000.0, 30000.0);
+            std::vector<int> vExp;
+            for (int i = 0; i < n; i++)
+                if (soa.alt_ft[size_t(i)] >= 1000.0 && soa.alt_ft[size_t(i)] <= 30000.0 &&
+                    TestDistNm(lat, lon, soa.lat[size_t(i)], soa.lon[size_t(i)]) <= radius)
+                    vExp.push_back(i);
+            std::sort(vIdx.begin(), vIdx.end());
+            CHECK(vIdx == vExp);
+        }
+
+        // box, also crossing the antimeridian
+        for (double d : { 1.0, 20.0, 100.0 }) {
+            const double latMin = std::max(-90.0, lat - d), latMax = std::min(90.0, lat + d);
+            double lonMin = lon - d, lonMax = lon + d;
+            if (lonMin < -180.0) lonMin += 360.0;
+            if (lonMax >= 180.0) lonMax -= 360.0;
+            conn.queryBox(latMin, latMax, lonMin, lonMax, vIdx);
+            std::vector<int> vExp;
+            for (int i = 0; i < n; i++) {
+                const double aLat = soa.lat[size_t(i)], aLon = soa.lon[size_t(i)];
+                const bool bLon = lonMin <= lonMax ? (aLon >= lonMin && aLon <= lonMax) : (aLon >= lonMin || aLon <= lonMax);
+                if (aLat >= latMin && aLat <= latMax && bLon)
+                    vExp.push_back(i);
+            }
+            std::sort(vIdx.begin(), vIdx.end());
+            CHECK(vIdx == vExp);
+        }
+
+        // nearest k: same distances as the k smallest of all
+        std::vector<double> vAll;
+        for (int i = 0; i < n; i++)
+            vAll.push_back(TestDistNm(lat, lon, soa.lat[size_t(i)], soa.lon[size_t(i)]));
+        std::sort(vAll.begin(), vAll.end());
+        for (int k : { 1, 5, 50, n }) {
+            conn.nearestK(lat, lon, k, vIdx);
+            CHECK(int(vIdx.size()) == k);
+            bool bOk = int(vIdx.size()) == k;
+            for (size_t j = 0; bOk && j < vIdx.size(); j++)
+                bOk = std::abs(TestDistNm(lat, lon, soa.lat[size_t(vIdx[j])], soa.lon[size_t(vIdx[j])]) - vAll[j]) < 1e-6;
+            CHECK(bOk);
+            if (!bOk)
+                fprintf(stderr, "  nearestK(%g, %g, %d)\n", lat, lon, k);
+        }
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,151 @@
+/*
+ * Position history: ring buffer, interpolation across seams, clamped extrapolation,
+ * and which updates add samples
+ */
+
+#include <chrono>
+#include <cmath>
+
+#include "XPilotAPITest.h"
+
+typedef std::chrono::steady_clock ClockTy;
+
+static const ClockTy::time_point T0 = ClockTy::time_point() + std::chrono::seconds(1000);
+
+static XPilotAPIPosSample Sample(double sec, double lat, double lon, float hdg = 0.0f, float spd = 0.0f, double alt = 0.0)
+{
+    XPilotAPIPosSample s;
+    s.ts = T0 + std::chrono::duration_cast<ClockTy::duration>(std::chrono::duration<double>(sec));
+    s.lat = lat;
+    s.lon = lon;
+    s.alt_ft = alt;
+    s.heading = hdg;
+    s.speed_kt = spd;
+    return s;
+}
+
+static ClockTy::time_point At(double sec)
+{
+    return T0 + std::chrono::duration_cast<ClockTy::duration>(std::chrono::duration<double>(sec));
+}
+
+static bool Near(double a, double b, double eps = 1e-6) { return std::abs(a - b) < eps; }
+
+int main()
+{
+    XPilotAPIPosSample out;
+
+    // ring buffer: keeps the newest `capacity` samples
+    {
+        XPilotAPIHistory h;
+        CHECK(h.positionAt(T0, out) == XPilotAPIHistory::POS_NONE);
+        h.push(Sample(0.0, 1.0, 1.0));          // no capacity yet: ignored
+        CHECK(h.empty());
+        h.setCapacity(4);
+        for (int i = 1; i <= 6; i++)
+            h.push(Sample(double(i), double(i), 0.0));
+        CHECK(h.size() == 4 && h.capacity() == 4);
+        CHECK(h.at(0).lat == 3.0 && h.newest().lat == 6.0);
+        bool bOrdered = true;
+        for (int i = 1; i < h.size(); i++)
+            bOrdered = bOrdered && h.at(i).ts > h.at(i - 1).ts;
+        CHECK(bOrdered);
+
+        // before the oldest sample still kept
+        CHECK(h.positionAt(At(1.0), out) == XPilotAPIHistory::POS_OLDEST);
+        CHECK(out.lat == 3.0);
+        // exactly at a sample, and between samples
+        CHECK(h.positionAt(At(4.0), out) == XPilotAPIHistory::POS_INTERPOLATED);
+        CHECK(out.lat == 4.0);
+        CHECK(h.positionAt(At(5.25), out) == XPilotAPIHistory::POS_INTERPOLATED);
+        CHECK(Near(out.lat, 5.25));
+        CHECK(h.positionAt(At(6.0), out) == XPilotAPIHistory::POS_INTERPOLATED);
+        CHECK(out.lat == 6.0);
+
+        h.clear();
+        CHECK(h.empty() && h.capacity() == 4);
+    }
+
+    // interpolation across the antimeridian and across north in heading
+    {
+        XPilotAPIHistory h;
+        h.setCapacity(8);
+        h.push(Sample(0.0, 10.0, 179.9, 350.0f, 100.0f, 1000.0));
+        h.push(Sample(10.0, 10.2, -179.9, 10.0f, 200.0f, 2000.0));
+        CHECK(h.positionAt(At(2.5), out) == XPilotAPIHistory::POS_INTERPOLATED);
+        CHECK(Near(out.lat, 10.05) && Near(out.lon, 179.95) && Near(out.heading, 355.0, 1e-4));
+        CHECK(Near(out.alt_ft, 1250.0) && Near(out.speed_kt, 125.0, 1e-4));
+        CHECK(h.positionAt(At(5.0), out) == XPilotAPIHistory::POS_INTERPOLATED);
+        CHECK(Near(std::abs(out.lon), 180.0) && Near(out.heading, 0.0, 1e-4));
+        CHECK(h.positionAt(At(7.5), out) == XPilotAPIHistory::POS_INTERPOLATED);
+        CHECK(Near(out.lon, -179.95) && Near(out.heading, 5.0, 1e-4));
+        CHECK(out.heading >= 0.0f && out.heading < 360.0f);
+    }
+
+    // extrapolation along the heading with the speed, at most `maxExtrapolation`
+    {
+        XPilotAPIHistory h;
+        h.setCapacity(2);
+        h.push(Sample(0.0, 0.0, 179.99, 90.0f, 360.0f));    // 1 nm per 10 s eastwards
+        CHECK(h.positionAt(At(5.0), out) == XPilotAPIHistory::POS_EXTRAPOLATED);
+        CHECK(Near(TestDistNm(0.0, 179.99, out.lat, out.lon), 0.5, 1e-4));
+        CHECK(Near(out.lat, 0.0));
+        CHECK(h.positionAt(At(10.0), out) == XPilotAPIHistory::POS_EXTRAPOLATED);
+        CHECK(Near(TestDistNm(0.0, 179.99, out.lat, out.lon), 1.0, 1e-4));
+        // crossed the antimeridian, normalized
+        CHECK(out.lon < -179.98 && out.lon >= -180.0);
+        CHECK(out.ts == At(10.0));
+        // clamped to 10 s by default, and to a given limit
+        CHECK(h.positionAt(At(60.0), out) == XPilotAPIHistory::POS_EXTRAPOLATED);
+        CHECK(Near(TestDistNm(0.0, 179.99, out.lat, out.lon), 1.0, 1e-4));
+        CHECK(h.positionAt(At(60.0), out, std::chrono::seconds(2)) == XPilotAPIHistory::POS_EXTRAPOLATED);
+        CHECK(Near(TestDistNm(0.0, 179.99, out.lat, out.lon), 0.2, 1e-4));
+
+        // northwards, a degree of latitude is 60 nm
+        XPilotAPIHistory hN;
+        hN.setCapacity(1);
+        hN.push(Sample(0.0, 45.0, 7.0, 0.0f, 3600.0f));
+        CHECK(hN.positionAt(At(10.0), out) == XPilotAPIHistory::POS_EXTRAPOLATED);
+        CHECK(Near(out.lon, 7.0) && Near(TestDistNm(45.0, 7.0, out.lat, out.lon), 10.0, 1e-4));
+    }
+
+    // a connection only samples if position, attitude, or speed changed
+    {
+        XPilotAPITestBackend backend;
+        XPilotAPIBackendGuard guard(backend);
+        backend.add(1, 40.0, -74.0);
+        XPilotAPIConnect conn;
+        conn.setHistoryCapacity(16);
+        conn.UpdateAcStore();
+        const XPilotAPIAircraft& ac = *conn.getAcStore().get(1);
+        CHECK(ac.getHistory().capacity() == 16);
+        CHECK(ac.getHistory().size() == 1);         // new aircraft
+
+        conn.UpdateAcStore();                       // nothing changed
+        backend.bulk(0).gear = 1.0f;                // DIRTY_CONFIG
+        conn.UpdateAcStore();
+        backend.bulk(0).terrainAlt_ft = 100.0f;     // DIRTY_TERRAIN
+        backend.bulk(0).bits.bcn = true;            // DIRTY_LIGHTS
+        conn.UpdateAcStore();
+        CHECK(ac.getHistory().size() == 1);
+
+        backend.bulk(0).lat += 0.01;                // DIRTY_POS
+        conn.UpdateAcStore();
+        CHECK(ac.getHistory().size() == 2);
+        backend.bulk(0).heading = 45.0f;            // DIRTY_ATTITUDE
+        conn.UpdateAcStore();
+        CHECK(ac.getHistory().size() == 3);
+        backend.bulk(0).speed_kt = 250.0f;          // DIRTY_SPEED
+        conn.UpdateAcStore();
+        CHECK(ac.getHistory().size() == 4);
+        CHECK(ac.getHistory().newest().speed_kt == 250.0f && ac.getHistory().newest().heading == 45.0f);
+
+        // switched off
+        conn.setHistoryCapacity(0);
+        backend.bulk(0).lat += 0.01;
+        conn.UpdateAcStore();
+        CHECK(ac.getHistory().empty() && ac.getHistory().capacity() == 0);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,157 @@
+/*
+ * Derived motion values: vertical speed, turn rate, track, and acceleration
+ */
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "XPilotAPITest.h"
+
+// Expected smoothed values of one aircraft, computed in double precision
+struct ExpTy
+{
+    uint64_t key = 0;
+    double ts = 0.0;
+    double vsi = 0.0, turn = 0.0, track = 0.0, accel = 0.0;
+};
+
+static const double D2R = 3.14159265358979323846 / 180.0;
+
+// Signed difference of two angles in (-180, 180]
+static double AngleDiff(double a, double b)
+{
+    return std::remainder(a - b, 360.0);
+}
+
+static bool Near(double a, double b, double eps)
+{
+    return std::abs(a - b) <= eps * std::max(1.0, std::abs(b));
+}
+
+int main()
+{
+    typedef XPilotAPITestBackend::BulkTy BulkTy;
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+
+    // 1: climbing northwards, 2: turning right across north,
+    // 3: eastwards across the antimeridian, 4: accelerating westwards,
+    // 5: turning on the spot, 6: standing still
+    backend.add(1, 40.0, -74.0, 1000.0);
+    backend.add(2, 10.0, 20.0, 3000.0);
+    backend.add(3, 0.0, 179.9995, 5000.0);
+    backend.add(4, 50.0, 8.0, 0.0);
+    backend.add(5, 30.0, 30.0, 0.0);
+    backend.add(6, -30.0, -60.0, 0.0);
+    backend.bulk(0).heading = 0.0f;     backend.bulk(0).speed_kt = 200.0f;
+    backend.bulk(1).heading = 340.0f;   backend.bulk(1).speed_kt = 250.0f;
+    backend.bulk(2).heading = 90.0f;    backend.bulk(2).speed_kt = 300.0f;
+    backend.bulk(3).heading = 270.0f;   backend.bulk(3).speed_kt = 0.0f;
+    backend.bulk(4).heading = 123.0f;   backend.bulk(4).speed_kt = 0.0f;
+    backend.bulk(5).heading = 45.0f;    backend.bulk(5).speed_kt = 0.0f;
+
+    const double tau = 0.05;
+    XPilotAPIConnect conn;
+    conn.kinSmoothingSec = tau;
+    conn.UpdateAcStore();
+    const XPilotAPIFleetSoA& soa = conn.getFleetSoA();
+    const XPilotAPIAcStore& store = conn.getAcStore();
+
+    // first record: nothing derived yet, track is the heading
+    std::vector<ExpTy> vExp(6);
+    bool bInit = true;
+    for (size_t k = 0; k < vExp.size(); k++) {
+        const int idx = store.find(k + 1);
+        vExp[k].key = k + 1;
+        vExp[k].ts = soa.ts[size_t(idx)];
+        vExp[k].track = backend.bulk(k).heading;
+        bInit = bInit && soa.ts[size_t(idx)] > 0.0 && soa.vsi_fpm[size_t(idx)] == 0.0f &&
+                soa.turnRate_dps[size_t(idx)] == 0.0f && soa.accel_kts[size_t(idx)] == 0.0f &&
+                soa.track[size_t(idx)] == backend.bulk(k).heading;
+    }
+    CHECK(bInit);
+
+    bool bSoA = true, bObj = true;
+    bool bCrossed = false, bTurnedAcross = false;
+    for (int step = 0; step < 12; step++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+        std::vector<BulkTy> vPrev;
+        for (size_t k = 0; k < vExp.size(); k++)
+            vPrev.push_back(backend.bulk(k));
+
+        // climb at constant speed and heading
+        backend.bulk(0).lat += 0.001;
+        backend.bulk(0).alt_ft += 100.0;
+        // turn right by 5 degrees per update, across north
+        backend.bulk(1).heading = float(std::fmod(backend.bulk(1).heading + 5.0, 360.0));
+        backend.bulk(1).lon += 0.0005;
+        bTurnedAcross = bTurnedAcross || backend.bulk(1).heading < 10.0f;
+        // eastwards, wrapping from +180 to -180
+        backend.bulk(2).lon += 0.0002;
+        if (backend.bulk(2).lon >= 180.0) {
+            backend.bulk(2).lon -= 360.0;
+            bCrossed = true;
+        }
+        // accelerate and descend westwards
+        backend.bulk(3).speed_kt += 10.0f;
+        backend.bulk(3).lon -= 0.001;
+        backend.bulk(3).alt_ft -= 20.0;
+        // turn left on the spot: no track change
+        backend.bulk(4).heading -= 7.0f;
+        conn.UpdateAcStore();
+
+        for (size_t k = 0; k < vExp.size(); k++) {
+            const BulkTy& c = backend.bulk(k);
+            const BulkTy& p = vPrev[k];
+            ExpTy& e = vExp[k];
+            const size_t idx = size_t(store.find(e.key));
+            const bool bChg = c.lat != p.lat || c.lon != p.lon || c.alt_ft != p.alt_ft ||
+                              c.heading != p.heading || c.speed_kt != p.speed_kt;
+            if (bChg) {
+                const double now = soa.ts[idx];
+                const double dt = now - e.ts;
+                const double a = dt / (tau + dt);
+                e.vsi += a * ((c.alt_ft - p.alt_ft) / dt * 60.0 - e.vsi);
+                e.turn += a * (AngleDiff(c.heading, p.heading) / dt - e.turn);
+                e.accel += a * ((double(c.speed_kt) - p.speed_kt) / dt - e.accel);
+                const double dEast = std::remainder(c.lon - p.lon, 360.0) * std::cos(c.lat * D2R);
+                const double dNorth = c.lat - p.lat;
+                if (dEast * dEast + dNorth * dNorth > 1e-12) {
+                    const double rawTrack = std::atan2(dEast, dNorth) / D2R;
+                    e.track = std::fmod(e.track + a * AngleDiff(rawTrack, e.track) + 360.0, 360.0);
+                }
+                e.ts = now;
+            }
+            else
+                bSoA = bSoA && soa.ts[idx] == e.ts;     // unchanged records keep their time
+
+            bSoA = bSoA && Near(soa.vsi_fpm[idx], e.vsi, 1e-3) && Near(soa.turnRate_dps[idx], e.turn, 1e-3) &&
+                   Near(soa.accel_kts[idx], e.accel, 1e-3) && std::abs(AngleDiff(soa.track[idx], e.track)) < 0.01;
+            const XPilotAPIKinematics& kin = store[int(idx)]->getKinematics();
+            bObj = bObj && kin.vsi_fpm == soa.vsi_fpm[idx] && kin.turnRate_dps == soa.turnRate_dps[idx] &&
+                   kin.track == soa.track[idx] && kin.accel_kts == soa.accel_kts[idx];
+            if (!bSoA) {
+                fprintf(stderr, "  aircraft %llu in step %d\n", (unsigned long long)e.key, step);
+                break;
+            }
+        }
+    }
+    CHECK(bCrossed && bTurnedAcross);
+    CHECK(bSoA);
+    CHECK(bObj);
+
+    // plausibility of the end results, independent of the exact timing
+    auto kinOf = [&](uint64_t key) { return store[store.find(key)]->getKinematics(); };
+    CHECK(kinOf(1).vsi_fpm > 0.0f && std::abs(AngleDiff(kinOf(1).track, 0.0)) < 1.0);
+    CHECK(kinOf(2).turnRate_dps > 0.0f);                // right turn, also across north
+    CHECK(std::abs(AngleDiff(kinOf(3).track, 90.0)) < 1.0);     // not thrown off by the antimeridian
+    CHECK(kinOf(4).accel_kts > 0.0f && kinOf(4).vsi_fpm < 0.0f);
+    CHECK(std::abs(AngleDiff(kinOf(4).track, 270.0)) < 1.0);
+    CHECK(kinOf(5).turnRate_dps < 0.0f && kinOf(5).track == 123.0f);
+    const XPilotAPIKinematics k6 = kinOf(6);
+    CHECK(k6.vsi_fpm == 0.0f && k6.turnRate_dps == 0.0f && k6.accel_kts == 0.0f && k6.track == 45.0f);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,110 @@
+/*
+ * Lookup by multiplayer slot while slots move between aircraft
+ */
+
+#include <utility>
+
+#include "XPilotAPITest.h"
+
+// Do both lookups agree with the slots xPilot reports right now?
+static bool SlotsMatch(XPilotAPITestBackend& backend, const XPilotAPIConnect& conn)
+{
+    bool bOK = true;
+    for (int slot = 1; slot < 128; slot++) {
+        uint64_t keyExp = 0;
+        for (int i = 0; i < backend.getNumAc(); i++)
+            if (backend.bulk(size_t(i)).bits.multiIdx == slot)
+                keyExp = backend.bulk(size_t(i)).keyNum;
+        const SPtrXPilotAPIAircraft pAc = conn.getAcByMultIdx(slot);
+        bOK = bOK && (pAc ? pAc->getKeyNum() : 0) == keyExp;
+    }
+    for (int i = 0; i < backend.getNumAc(); i++)
+        bOK = bOK && conn.getMultIdxByKey(backend.bulk(size_t(i)).keyNum) == backend.bulk(size_t(i)).bits.multiIdx;
+    return bOK;
+}
+
+// Position of the aircraft with key `key` in xPilot's arrays
+static size_t PosOf(XPilotAPITestBackend& backend, uint64_t key)
+{
+    for (size_t i = 0; i < size_t(backend.getNumAc()); i++)
+        if (backend.bulk(i).keyNum == key)
+            return i;
+    return size_t(-1);
+}
+
+static void SetSlot(XPilotAPITestBackend& backend, uint64_t key, int slot)
+{
+    backend.bulk(PosOf(backend, key)).bits.multiIdx = slot;
+}
+
+int main()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    for (uint64_t key = 1; key <= 6; key++) {
+        backend.add(key, 40.0 + key * 0.01, -74.0);
+        backend.bulk(size_t(key - 1)).bits.multiIdx = int(key) * 10;
+    }
+    XPilotAPIConnect conn;
+    conn.UpdateAcStore();
+    CHECK(SlotsMatch(backend, conn));
+    CHECK(!conn.getAcByMultIdx(0));
+    CHECK(!conn.getAcByMultIdx(128));
+    CHECK(conn.getMultIdxByKey(99) == 0);
+
+    // two aircraft swap slots in one fetch, the earlier one in the array taking the higher slot...
+    SetSlot(backend, 1, 20);
+    SetSlot(backend, 2, 10);
+    conn.UpdateAcStore();
+    CHECK(SlotsMatch(backend, conn));
+    CHECK(conn.getAcByMultIdx(10) && conn.getAcByMultIdx(10)->getKeyNum() == 2);
+
+    // ...and the lower slot, after they swapped their positions in the array, too
+    std::swap(backend.bulk(0), backend.bulk(1));
+    std::swap(backend.info(0), backend.info(1));
+    conn.UpdateAcStore();
+    CHECK(SlotsMatch(backend, conn));
+    SetSlot(backend, 1, 10);
+    SetSlot(backend, 2, 20);
+    conn.UpdateAcStore();
+    CHECK(SlotsMatch(backend, conn));
+    CHECK(conn.getAcByMultIdx(20) && conn.getAcByMultIdx(20)->getKeyNum() == 2);
+
+    // a rotation through three aircraft, and a slot taken over by an aircraft that had none
+    SetSlot(backend, 3, 40);
+    SetSlot(backend, 4, 50);
+    SetSlot(backend, 5, 30);
+    conn.UpdateAcStore();
+    CHECK(SlotsMatch(backend, conn));
+
+    // an aircraft drops to slot 0: not reported via sim/multiplayer any longer
+    SetSlot(backend, 6, 0);
+    conn.UpdateAcStore();
+    CHECK(SlotsMatch(backend, conn));
+    CHECK(!conn.getAcByMultIdx(60));
+    CHECK(conn.getMultIdxByKey(6) == 0);
+    SetSlot(backend, 6, 60);
+    conn.UpdateAcStore();
+    CHECK(SlotsMatch(backend, conn));
+
+    // removing the aircraft at store index 0 moves the last one into its index
+    const uint64_t keyFirst = conn.getAcStore().keyAt(0);
+    const uint64_t keyLast = conn.getAcStore().keyAt(conn.getAcStore().size() - 1);
+    const int slotFirst = conn.getMultIdxByKey(keyFirst);
+    backend.erase(PosOf(backend, keyFirst));
+    conn.UpdateAcStore();
+    CHECK(conn.getAcStore().keyAt(0) == keyLast);
+    CHECK(!conn.getAcByMultIdx(slotFirst));
+    const SPtrXPilotAPIAircraft pLast = conn.getAcByMultIdx(conn.getMultIdxByKey(keyLast));
+    CHECK(pLast && pLast->getKeyNum() == keyLast);
+    CHECK(SlotsMatch(backend, conn));
+
+    // the removed aircraft's slot is free for a new one
+    const size_t i = backend.add(7, 41.0, -74.0);
+    backend.bulk(i).bits.multiIdx = slotFirst;
+    conn.UpdateAcStore();
+    CHECK(conn.getAcByMultIdx(slotFirst) && conn.getAcByMultIdx(slotFirst)->getKeyNum() == 7);
+    CHECK(SlotsMatch(backend, conn));
+
+    return TEST_RESULT();
+}
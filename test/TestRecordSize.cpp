@@ -0,0 +1,119 @@
+/*
+ * Records of an older xPilot, shorter than ours, in the aircraft objects, the per-aircraft
+ * arrays, views, and shared mode
+ */
+
+#include <cstddef>
+#include <string>
+
+#include "XPilotAPITest.h"
+
+// Reports shorter records, like an xPilot version without the newest fields.
+// The records themselves are delivered as before, so data beyond the reported
+// size is garbage the connection must not pick up.
+class ShortRecordBackend : public XPilotAPITestBackend
+{
+public:
+    static constexpr int SIZE_BULK = int(offsetof(BulkTy, bearing));
+    static constexpr int SIZE_INFO = int(offsetof(InfoTy, cslModel));
+
+    int GetDatab(XPLMDataRef inDataRef, void* outValue, int inOffset, int inMaxBytes) override
+    {
+        if (!outValue && intptr_t(inDataRef) == DR_BULK_QUICK)
+            return SIZE_BULK;
+        if (!outValue && intptr_t(inDataRef) == DR_BULK_EXPSV)
+            return SIZE_INFO;
+        return XPilotAPITestBackend::GetDatab(inDataRef, outValue, inOffset, inMaxBytes);
+    }
+};
+
+int main()
+{
+    typedef XPilotAPITestBackend::BulkTy BulkTy;
+    typedef XPilotAPITestBackend::InfoTy InfoTy;
+
+    // directly: only the first `__inSize` bytes count
+    {
+        BulkTy bulk;
+        bulk.keyNum = 7;
+        bulk.lat = 40.0;
+        bulk.bearing = 90.0f;
+        bulk.dist_nm = 12.0f;
+        XPilotAPIAircraft ac;
+        CHECK(ac.updateAircraft(bulk, size_t(ShortRecordBackend::SIZE_BULK)));
+        CHECK(ac.getBulk().lat == 40.0);
+        CHECK(ac.getBulk().bearing == 0.0f && ac.getBulk().dist_nm == 0.0f);
+
+        InfoTy info;
+        info.keyNum = 7;
+        strcpy(info.callSign, "DLH1");
+        strcpy(info.cslModel, "GARBAGE");
+        CHECK(ac.updateAircraft(info, size_t(ShortRecordBackend::SIZE_INFO)));
+        CHECK(std::string(ac.getInfo().callSign) == "DLH1");
+        CHECK(ac.getInfo().cslModel[0] == 0);
+
+        // too short to even hold the key
+        CHECK(!ac.updateAircraft(bulk, 4));
+        CHECK(!ac.updateAircraft(info, 0));
+    }
+
+    // through a connection
+    ShortRecordBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    for (uint64_t key = 1; key <= 120; key++) {
+        const size_t i = backend.add(key, 40.0 + key * 0.01, -74.0, 5000.0, "CS");
+        backend.bulk(i).bearing = 45.0f;
+        backend.bulk(i).dist_nm = 3.0f;
+        backend.bulk(i).bits.multiIdx = int(key);
+        strcpy(backend.info(i).cslModel, "GARBAGE");
+    }
+    XPilotAPIConnect conn(XPilotAPIAircraft::CreateNewObject, 50);
+    conn.setShared(true);
+    XPilotAPIConnect cons;
+    cons.setShared(true);
+    // twice: the garbage stays in the fetch buffer of the second update
+    for (int n = 0; n < 2; n++) {
+        conn.UpdateAcStore();
+        cons.UpdateAcStore();
+    }
+    CHECK(conn.isSharedProvider() && !cons.isSharedProvider());
+
+    // neither aircraft objects, nor per-aircraft arrays, nor the multiplayer
+    // slots (which live beyond the shorter record) pick up the garbage
+    for (const XPilotAPIConnect* pConn : { &conn, &cons }) {
+        const XPilotAPIAcStore& store = pConn->getAcStore();
+        const XPilotAPIFleetSoA& soa = pConn->getFleetSoA();
+        CHECK(store.size() == 120);
+        bool bDefaults = true, bValues = true, bSoA = true, bMultIdx = true;
+        for (int i = 0; i < store.size(); i++) {
+            const XPilotAPIAircraft& ac = *store[i];
+            bDefaults = bDefaults && ac.getBulk().bearing == 0.0f && ac.getBulk().dist_nm == 0.0f &&
+                        ac.getBulk().bits.multiIdx == 0 && ac.getInfo().cslModel[0] == 0;
+            bValues = bValues && ac.getBulk().lat == 40.0 + ac.getKeyNum() * 0.01 &&
+                      std::string(ac.getInfo().callSign) == "CS";
+            bSoA = bSoA && soa.bearing[size_t(i)] == 0.0f && soa.dist_nm[size_t(i)] == 0.0f &&
+                   soa.multiIdx[size_t(i)] == 0 && soa.lat[size_t(i)] == ac.getBulk().lat;
+            bMultIdx = bMultIdx && pConn->getMultIdxByKey(ac.getKeyNum()) == 0;
+        }
+        for (int slot = 1; slot < 128; slot++)
+            bMultIdx = bMultIdx && !pConn->getAcByMultIdx(slot);
+        CHECK(bDefaults);
+        CHECK(bValues);
+        CHECK(bSoA);
+        CHECK(bMultIdx);
+    }
+
+    // views agree
+    int numRec = 0;
+    bool bView = true;
+    conn.FetchView<XPilotAPIField::Lat, XPilotAPIField::Bearing>([&](const auto& view) {
+        bView = bView && view.template has<XPilotAPIField::Lat>() && !view.template has<XPilotAPIField::Bearing>();
+        for (int i = 0; i < view.size(); i++)
+            bView = bView && view.template get<XPilotAPIField::Bearing>(i) == 0.0f;
+        numRec += view.size();
+    });
+    CHECK(numRec == 120);
+    CHECK(bView);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,117 @@
+/*
+ * Recording and replay, also after failed writes
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "XPilotAPITest.h"
+
+typedef std::map<uint64_t, double> FrameTy;    // key -> latitude
+
+// Records `numFrames` updates of a moving fleet, returns what each update saw
+static std::vector<FrameTy> Record(XPilotAPIRecorder& rec, int numFrames)
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    for (uint64_t key = 1; key <= 20; key++)
+        backend.add(key, 40.0 + key * 0.01, -74.0);
+
+    XPilotAPIConnect conn;
+    conn.setRecorder(&rec);
+    std::vector<FrameTy> vFrames;
+    for (int f = 0; f < numFrames; f++) {
+        for (int i = 0; i < backend.getNumAc(); i++)
+            backend.bulk(size_t(i)).lat += 0.001 * (i % 3);
+        if (f == numFrames / 2)
+            backend.erase(3);
+        conn.UpdateAcStore();
+        FrameTy frame;
+        for (const SPtrXPilotAPIAircraft& pAc : conn.getAcStore())
+            frame[pAc->getKeyNum()] = pAc->getLat();
+        vFrames.push_back(frame);
+    }
+    conn.setRecorder(nullptr);
+    return vFrames;
+}
+
+// Replays a recording and compares each frame with `vExp`
+static bool Replay(const std::string& path, const std::vector<FrameTy>& vExp)
+{
+    XPilotAPIReplayBackend replay;
+    if (!replay.open(path) || replay.getNumFrames() != vExp.size())
+        return false;
+    XPilotAPIBackendGuard guard(replay);
+    XPilotAPIConnect conn;
+    for (const FrameTy& exp : vExp) {
+        if (!replay.nextFrame())
+            return false;
+        conn.UpdateAcStore();
+        FrameTy frame;
+        for (const SPtrXPilotAPIAircraft& pAc : conn.getAcStore())
+            frame[pAc->getKeyNum()] = pAc->getLat();
+        if (frame != exp)
+            return false;
+    }
+    return true;
+}
+
+// Recorder whose file starts failing on request
+class FailingRecorder : public XPilotAPIRecorder
+{
+public:
+    // The file keeps what was written so far, later writes fail
+    void breakFile()
+    {
+        fclose(pFile);
+        pFile = fopen("/dev/full", "wb");
+        setvbuf(pFile, NULL, _IONBF, 0);
+    }
+};
+
+int main()
+{
+    char path[] = "/tmp/XPilotAPITestRecXXXXXX";
+    const int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+
+    // round trip, with keyframes and difference frames
+    {
+        XPilotAPIRecorder rec;
+        rec.keyframeInterval = 7;
+        CHECK(rec.open(path));
+        const std::vector<FrameTy> vFrames = Record(rec, 30);
+        CHECK(rec.close());
+        CHECK(!rec.hasFailed());
+        CHECK(Replay(path, vFrames));
+    }
+
+    // unwritable file fails right in open()
+    {
+        XPilotAPIRecorder rec;
+        CHECK(!rec.open("/dev/full"));
+        CHECK(rec.hasFailed() && !rec.isOpen());
+        CHECK(!rec.close());
+    }
+
+    // writing fails after 10 frames: those stay readable, nothing else is written
+    {
+        FailingRecorder rec;
+        rec.keyframeInterval = 4;
+        CHECK(rec.open(path));
+        std::vector<FrameTy> vFrames = Record(rec, 10);
+        CHECK(rec.getNumFrames() == 10);
+        rec.breakFile();
+        Record(rec, 5);
+        CHECK(rec.hasFailed());
+        CHECK(rec.getNumFrames() == 10);
+        CHECK(!rec.close());
+        CHECK(Replay(path, vFrames));
+    }
+
+    unlink(path);
+    return TEST_RESULT();
+}
@@ -0,0 +1,108 @@
+/*
+ * Reference points maintained from change sets, compared with brute force
+ */
+
+#include <vector>
+
+#include "XPilotAPITest.h"
+
+static double TestBearing(double lat1, double lon1, double lat2, double lon2)
+{
+    const double D2R = 3.14159265358979323846 / 180.0;
+    const double dLon = (lon2 - lon1) * D2R;
+    const double y = std::sin(dLon) * std::cos(lat2 * D2R);
+    const double x = std::cos(lat1 * D2R) * std::sin(lat2 * D2R) -
+                     std::sin(lat1 * D2R) * std::cos(lat2 * D2R) * std::cos(dLon);
+    const double brg = std::atan2(y, x) / D2R;
+    return brg < 0.0 ? brg + 360.0 : brg;
+}
+
+// All values of all reference points match a fresh computation
+static bool MatchesBruteForce(const XPilotAPIConnect& conn, const std::vector<int>& vIds)
+{
+    const XPilotAPIAcStore& store = conn.getAcStore();
+    for (int id : vIds) {
+        const XPilotAPIRefPoint* pRef = conn.getRefPoint(id);
+        if (!pRef || (int)pRef->dist_nm.size() != store.size() || (int)pRef->bearing.size() != store.size())
+            return false;
+        for (int i = 0; i < store.size(); i++) {
+            const double dist = TestDistNm(pRef->lat, pRef->lon, store[i]->getLat(), store[i]->getLon());
+            if (std::abs(pRef->dist_nm[size_t(i)] - dist) > 0.01 + dist * 1e-5)
+                return false;
+            if (dist < 0.01)
+                continue;                           // bearing undefined
+            double dBrg = std::abs(pRef->bearing[size_t(i)] -
+                                   TestBearing(pRef->lat, pRef->lon, store[i]->getLat(), store[i]->getLon()));
+            dBrg = std::min(dBrg, 360.0 - dBrg);
+            if (dBrg > 0.01)
+                return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    TestRnd rnd(18);
+    uint64_t nextKey = 1;
+    auto addAc = [&]() {
+        backend.add(nextKey++, rnd() * 180.0 - 90.0, rnd() * 360.0 - 180.0, rnd() * 40000.0);
+    };
+    for (int i = 0; i < 300; i++)
+        addAc();
+
+    XPilotAPIConnect conn;
+    conn.UpdateAcStore();
+    std::vector<int> vIds = { conn.addRefPoint(40.6, -73.8), conn.addRefPoint(89.9, 0.0),
+                              conn.addRefPoint(0.0, 179.9) };
+    CHECK(MatchesBruteForce(conn, vIds));
+
+    bool bOk = true;
+    for (int upd = 0; upd < 100; upd++) {
+        for (int i = 0; i < backend.getNumAc(); i++) {
+            auto& b = backend.bulk(size_t(i));
+            const double r = rnd();
+            if (r < 0.2) {
+                b.lat = std::max(-90.0, std::min(90.0, b.lat + (rnd() - 0.5)));
+                b.lon += rnd() - 0.5;
+                if (b.lon >= 180.0) b.lon -= 360.0;
+                if (b.lon < -180.0) b.lon += 360.0;
+            }
+            else if (r < 0.3)
+                b.alt_ft += 100.0;
+            else if (r < 0.35)
+                b.heading = float(rnd() * 360.0);
+        }
+        for (int i = int(rnd() * 8.0); i > 0; i--)
+            addAc();
+        for (int i = int(rnd() * 8.0); i > 0 && backend.getNumAc() > 0; i--)
+            backend.erase(size_t(rnd() * backend.getNumAc()));
+
+        // reference points come, move, and go in between
+        if (upd == 30)
+            vIds.push_back(conn.addRefPoint(-33.9, 151.2));
+        if (upd == 50)
+            conn.moveRefPoint(vIds[0], 51.5, 0.0);
+        if (upd == 70) {
+            conn.removeRefPoint(vIds[1]);
+            vIds.erase(vIds.begin() + 1);
+        }
+
+        conn.UpdateAcStore();
+        bOk = bOk && MatchesBruteForce(conn, vIds);
+    }
+    CHECK(bOk);
+
+    // all aircraft gone and back
+    backend.clear();
+    conn.UpdateAcStore();
+    CHECK(MatchesBruteForce(conn, vIds));
+    for (int i = 0; i < 50; i++)
+        addAc();
+    conn.UpdateAcStore();
+    CHECK(MatchesBruteForce(conn, vIds));
+
+    return TEST_RESULT();
+}
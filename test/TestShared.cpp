@@ -0,0 +1,163 @@
+/*
+ * Shared mode: a consumer connection following the frames of a provider
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "XPilotAPITest.h"
+
+// Counts the changes a connection reports
+struct ChangeCounter
+{
+    int numCallbacks = 0;
+    size_t numAdded = 0, numRemoved = 0, numTextChanged = 0;
+    std::map<uint64_t, int> mapTextChanged;
+
+    static void OnChanges(const XPilotAPIChangeSet& changes, void* refcon)
+    {
+        ChangeCounter& cnt = *static_cast<ChangeCounter*>(refcon);
+        cnt.numCallbacks++;
+        cnt.numAdded += changes.added.size();
+        cnt.numRemoved += changes.removed.size();
+        cnt.numTextChanged += changes.textChanged.size();
+        for (const XPilotAPIAcEvent& ev : changes.textChanged)
+            cnt.mapTextChanged[ev.keyNum]++;
+    }
+};
+
+static std::string CallSign(const char* prefix, uint64_t key)
+{
+    return prefix + std::to_string(key);
+}
+
+// Does the connection have the same aircraft as xPilot with the expected call signs?
+static bool SameFleet(XPilotAPITestBackend& backend, const XPilotAPIConnect& conn)
+{
+    const XPilotAPIAcStore& store = conn.getAcStore();
+    int numExp = 0;
+    bool bOK = true;
+    for (int i = 0; i < backend.getNumAc(); i++) {
+        const XPilotAPITestBackend::InfoTy& info = backend.info(size_t(i));
+        if (!info.keyNum)
+            continue;
+        numExp++;
+        const int idx = store.find(info.keyNum);
+        bOK = bOK && idx >= 0 && std::string(store[idx]->getInfo().callSign) == info.callSign;
+    }
+    return bOK && store.size() == numExp;
+}
+
+int main()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    for (uint64_t key = 1; key <= 100; key++)
+        backend.add(key, 40.0 + key * 0.001, -74.0, 5000.0, CallSign("A", key).c_str());
+
+    // the provider refreshes only some texts per update
+    XPilotAPIConnect prov(XPilotAPIAircraft::CreateNewObject, 10);
+    prov.bStaggerExpsv = true;
+    prov.iExpsvBudgetAc = 15;
+    prov.setShared(true);
+    XPilotAPIConnect cons;
+    cons.setShared(true);
+    ChangeCounter cnt;
+    cons.subscribeChanges(ChangeCounter::OnChanges, &cnt);
+
+    prov.UpdateAcStore();
+    cons.UpdateAcStore();
+    CHECK(prov.isSharedProvider());
+    CHECK(!cons.isSharedProvider());
+    CHECK(SameFleet(backend, cons));
+    CHECK(cnt.numAdded == 100);
+
+    // texts of earlier frames are not applied again: nothing changes, nothing is reported
+    cnt = ChangeCounter();
+    for (int i = 0; i < 20; i++) {
+        prov.UpdateAcStore();
+        cons.UpdateAcStore();
+    }
+    CHECK(cnt.numTextChanged == 0);
+
+    // Shift all positions and change all texts: each aircraft reports its
+    // new text exactly once, as the staggered refresh reaches it
+    backend.erase(0);
+    backend.erase(50);
+    for (int i = 0; i < backend.getNumAc(); i++)
+        strncpy(backend.info(size_t(i)).callSign,
+                CallSign("B", backend.info(size_t(i)).keyNum).c_str(),
+                sizeof(backend.info(size_t(i)).callSign) - 1);
+    // an empty record is no aircraft
+    backend.add(0, 10.0, 10.0);
+    cnt = ChangeCounter();
+    for (int i = 0; i < 20; i++) {
+        prov.UpdateAcStore();
+        cons.UpdateAcStore();
+        // removed aircraft never come back
+        CHECK(cons.getAcStore().find(1) < 0);
+        CHECK(cons.getAcStore().find(52) < 0);
+    }
+    CHECK(cons.getAcStore().find(0) < 0);
+    CHECK(prov.getAcStore().find(0) < 0);
+    CHECK(SameFleet(backend, cons));
+    CHECK(cnt.numRemoved == 2);
+    CHECK(cnt.mapTextChanged.size() == 98);
+    bool bOnce = true;
+    for (const auto& p : cnt.mapTextChanged)
+        bOnce = bOnce && p.second == 1;
+    CHECK(bOnce);
+
+    // A budgeted provider pass spread over several calls:
+    // the consumer sees nothing of it until it is complete
+    for (uint64_t key = 201; key <= 225; key++)
+        backend.add(key, 41.0, -75.0, 5000.0, CallSign("B", key).c_str());
+    backend.erase(10);
+    cnt = ChangeCounter();
+    const auto past = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    int numCalls = 0;
+    bool bNothingEarly = true;
+    while (!prov.UpdateAcStoreBudgeted(past)) {
+        numCalls++;
+        cons.UpdateAcStore();
+        bNothingEarly = bNothingEarly && cnt.numCallbacks == 0 && cons.getAcStore().size() == 98;
+    }
+    CHECK(numCalls > 1);
+    CHECK(bNothingEarly);
+    cons.UpdateAcStore();
+    CHECK(cnt.numAdded == 25);
+    CHECK(cnt.numRemoved == 1);
+    CHECK(SameFleet(backend, cons));
+
+    // A provider that stops updating but stays loaded: after the timeout
+    // the consumer fetches itself, and follows the provider again once it resumes
+    cons.sharedTimeoutSec = 0.05;
+    cons.UpdateAcStore();
+    CHECK(cons.getNumFetchCalls() == 0);
+    backend.add(300, 42.0, -76.0, 5000.0, "B300");
+    cons.UpdateAcStore();
+    CHECK(cons.getNumFetchCalls() == 0 && cons.getAcStore().find(300) < 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    cons.UpdateAcStore();
+    CHECK(cons.getNumFetchCalls() > 0);
+    CHECK(!cons.isSharedProvider() && prov.isSharedProvider());
+    CHECK(SameFleet(backend, cons));
+    backend.erase(0);
+    cons.UpdateAcStore();
+    cons.UpdateAcStore();
+    CHECK(SameFleet(backend, cons));
+
+    prov.UpdateAcStore();
+    cons.UpdateAcStore();
+    CHECK(cons.getNumFetchCalls() == 0);
+    CHECK(SameFleet(backend, cons));
+    backend.add(301, 42.0, -76.0, 5000.0, "B301");
+    prov.UpdateAcStore();
+    cons.UpdateAcStore();
+    CHECK(cons.getNumFetchCalls() == 0 && cons.getAcStore().find(301) >= 0);
+
+    return TEST_RESULT();
+}
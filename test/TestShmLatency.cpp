@@ -0,0 +1,146 @@
+/*
+ * Shared-memory export read by another process: consistency, truncation, latency,
+ * and a writer dying in the middle of a frame
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "XPilotAPITest.h"
+
+static const int NUM_AC = 1000;
+static const int CAPACITY = 800;            // smaller than the fleet: frames are truncated
+static const uint64_t NUM_FRAMES = 2000;
+
+// Exporter that can die while writing a frame, leaving the counter odd
+class TestShmExporter : public XPilotAPIShmExporter
+{
+public:
+    void dieWhileWriting() { pHdr->fleet.seq.fetch_add(1, std::memory_order_release); }
+};
+
+static double Now()
+{
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Reader process: follows the frames in place and measures the time from writing to seeing them
+static int RunReader(const std::string& name)
+{
+    XPilotAPIShmReader reader;
+    const double tsStart = Now();
+    while (!reader.open(name) && Now() - tsStart < 10.0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    CHECK(reader.isOpen());
+    if (!reader.isOpen())
+        return TEST_RESULT();
+
+    const XPilotAPISharedFleet& fleet = *reader.getFleet();
+    std::vector<double> vLatency;
+    uint64_t lastFrame = 0;
+    bool bConsistent = true, bTruncated = true;
+    while (lastFrame < NUM_FRAMES && Now() - tsStart < 30.0) {
+        uint32_t seq;
+        uint64_t frame;
+        double ts, alt;
+        int numAc;
+        uint32_t numAcTotal;
+        bool bSame;
+        do {
+            seq = reader.beginRead();
+            frame = fleet.frame;
+            ts = fleet.ts;
+            numAc = fleet.numAc;
+            numAcTotal = fleet.numAcTotal;
+            // the writer puts the frame number into all altitudes
+            alt = numAc > 0 ? fleet.bulk()[0].alt_ft : 0.0;
+            bSame = true;
+            for (int i = 1; i < numAc && bSame; i++)
+                bSame = fleet.bulk()[i].alt_ft == alt;
+        } while (!reader.endRead(seq));
+        if (frame == lastFrame || numAc == 0)
+            continue;
+        vLatency.push_back(Now() - ts);
+        lastFrame = frame;
+        bConsistent = bConsistent && bSame;
+        bTruncated = bTruncated && numAc == CAPACITY && numAcTotal == uint32_t(NUM_AC) && fleet.isTruncated();
+    }
+    CHECK(lastFrame == NUM_FRAMES);
+    CHECK(bConsistent);
+    CHECK(bTruncated);
+
+    // the copying read reports the truncation, too
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkData> vBulk;
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkInfoTexts> vInfo;
+    uint64_t frame = 0;
+    double ts = 0.0;
+    uint32_t numAcTotal = 0;
+    CHECK(reader.read(vBulk, vInfo, frame, ts, 100, &numAcTotal));
+    CHECK(vBulk.size() == size_t(CAPACITY) && numAcTotal == uint32_t(NUM_AC));
+
+    CHECK(!vLatency.empty());
+    if (!vLatency.empty()) {
+        std::sort(vLatency.begin(), vLatency.end());
+        const double p50 = vLatency[vLatency.size() / 2] * 1e6;
+        const double p99 = vLatency[vLatency.size() * 99 / 100] * 1e6;
+        printf("%zu frames of %d aircraft seen, latency p50 %.1f us, p99 %.1f us\n",
+               vLatency.size(), CAPACITY, p50, p99);
+        // generous: a frame is seen while the writer waits for the next one
+        CHECK(p50 < 5000.0);
+        fflush(stdout);             // the reader ends with _exit()
+    }
+    return TEST_RESULT();
+}
+
+int main()
+{
+    const std::string name = "/xpilotapi_test_" + std::to_string(getpid());
+    const pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0)
+        _exit(RunReader(name));
+
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    for (uint64_t key = 1; key <= uint64_t(NUM_AC); key++)
+        backend.add(key, 40.0 + key * 0.001, -74.0, 0.0, "CS");
+
+    TestShmExporter exporter;
+    CHECK(exporter.open(name, CAPACITY));
+    XPilotAPIConnect conn(XPilotAPIAircraft::CreateNewObject, XPilotAPIConnect::BULK_AC_AUTO);
+    conn.setShmExporter(&exporter);
+    for (uint64_t frame = 1; frame <= NUM_FRAMES; frame++) {
+        for (int i = 0; i < NUM_AC; i++)
+            backend.bulk(size_t(i)).alt_ft = double(frame);
+        conn.UpdateAcStore();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+
+    // the writer died while writing: readers give up instead of waiting forever
+    XPilotAPIShmReader reader;
+    CHECK(reader.open(name));
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkData> vBulk;
+    std::vector<XPilotAPIAircraft::XPilotAPIBulkInfoTexts> vInfo;
+    uint64_t frame = 0;
+    double ts = 0.0;
+    CHECK(reader.read(vBulk, vInfo, frame, ts) && frame == NUM_FRAMES);
+    exporter.dieWhileWriting();
+    const uint32_t seq = reader.beginRead();
+    CHECK((seq & 1) && !reader.endRead(seq));
+    frame = 0;
+    CHECK(!reader.read(vBulk, vInfo, frame, ts, 10));
+    CHECK(frame == 0);
+    reader.close();
+    exporter.close();
+    return TEST_RESULT();
+}
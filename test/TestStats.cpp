@@ -0,0 +1,45 @@
+/*
+ * Statistics datarefs, built with and without XPILOTAPI_STATS
+ */
+
+#include <climits>
+
+#include "XPilotAPITest.h"
+
+int main()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    for (uint64_t key = 1; key <= 10; key++)
+        backend.add(key, 40.0, -74.0);
+
+    XPilotAPIConnect conn;
+    conn.publishStatsDataRefs();
+    for (int i = 0; i < 3; i++)
+        conn.UpdateAcStore();
+    XPLMDataRef drUpdates = backend.FindDataRef("xpilotapi/stats/updates");
+    XPLMDataRef drBytes = backend.FindDataRef("xpilotapi/stats/datab_bytes");
+    XPLMDataRef drP99 = backend.FindDataRef("xpilotapi/stats/total/p99_us");
+
+#ifdef XPILOTAPI_STATS
+    CHECK(drUpdates && drBytes && drP99);
+    CHECK(backend.GetDataRefTypes(drUpdates) == (xplmType_Int | xplmType_Float));
+    CHECK(backend.GetDatai(drUpdates) == 3);
+    CHECK(backend.GetDataf(drUpdates) == 3.0f);
+    CHECK(backend.GetDataRefTypes(drP99) == xplmType_Float);
+
+    // counters beyond the int range clamp as int, but not as float
+    const_cast<XPilotAPIStats&>(conn.getStats()).numDatabBytes = 5000000000ull;
+    CHECK(backend.GetDatai(drBytes) == INT_MAX);
+    CHECK(std::abs(backend.GetDataf(drBytes) - 5.0e9f) < 1.0e3f);
+
+    conn.unpublishStatsDataRefs();
+    CHECK(!backend.FindDataRef("xpilotapi/stats/updates"));
+#else
+    // nothing measured, nothing published
+    CHECK(!drUpdates && !drBytes && !drP99);
+    CHECK(conn.getStats().numUpdates == 0);
+#endif
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,119 @@
+/*
+ * Text accessors without copies, the cached description, and interned ids
+ */
+
+#include <string>
+#include <string_view>
+
+#include "XPilotAPITest.h"
+
+int main()
+{
+    // interning: equal texts share an id, from whatever storage they come
+    {
+        const int sizeBefore = XPilotAPIStrPool::size();
+        CHECK(XPilotAPIStrPool::intern("") == 0);
+        CHECK(XPilotAPIStrPool::find("") == 0);
+        CHECK(XPilotAPIStrPool::find("ZZZZ-not-interned") == XPilotAPIStrPool::NO_ID);
+        const XPilotAPIStrId id = XPilotAPIStrPool::intern("KJFK");
+        const std::string s = "KJFK";
+        const char buf[] = { 'K', 'J', 'F', 'K', 'X' };   // not zero-terminated
+        CHECK(id != 0 && id != XPilotAPIStrPool::NO_ID);
+        CHECK(XPilotAPIStrPool::intern(s) == id);
+        CHECK(XPilotAPIStrPool::intern(std::string_view(buf, 4)) == id);
+        CHECK(XPilotAPIStrPool::find("KJFK") == id);
+        CHECK(XPilotAPIStrPool::str(id) == "KJFK");
+        CHECK(XPilotAPIStrPool::intern("KLAX") != id);
+        CHECK(XPilotAPIStrPool::size() == sizeBefore + 2);
+        CHECK(XPilotAPIStrPool::str(XPilotAPIStrPool::NO_ID).empty());
+    }
+
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    backend.add(1, 40.0, -74.0, 5000.0, "DLH400");
+    backend.add(2, 41.0, -74.0, 5000.0, "UAL9");
+    auto setTexts = [&](size_t i, const char* type, const char* orig, const char* dest) {
+        strcpy(backend.info(i).modelIcao, type);
+        strcpy(backend.info(i).origin, orig);
+        strcpy(backend.info(i).destination, dest);
+        strcpy(backend.info(i).wtc, "M");
+        strcpy(backend.info(i).acClass, "L2J");
+    };
+    setTexts(0, "A321", "EDDF", "KJFK");
+    setTexts(1, "B738", "KLAX", "KJFK");
+
+    XPilotAPIConnect conn;
+    conn.sPeriodExpsv = std::chrono::seconds(0);   // texts with every update
+    conn.UpdateAcStore();
+    const XPilotAPIAcStore& store = conn.getAcStore();
+    const XPilotAPIAircraft& ac1 = *store.get(1);
+    const XPilotAPIAircraft& ac2 = *store.get(2);
+
+    // views show the texts without copies
+    CHECK(ac1.getCallSignView() == "DLH400");
+    CHECK(ac1.getModelIcaoView() == "A321");
+    CHECK(ac1.getOriginView() == "EDDF" && ac1.getDestinationView() == "KJFK");
+    CHECK(ac1.getWtcView() == "M" && ac1.getAcClassView() == "L2J");
+    CHECK(ac1.getSquawkView().empty() && ac1.getCslModelView().empty());
+    CHECK(ac1.getCallSignView().data() == ac1.getInfo().callSign);
+    CHECK(ac1.getKeyView() == ac1.getKey());
+
+    // interned ids of the aircraft
+    CHECK(ac1.getDestinationId() == ac2.getDestinationId());
+    CHECK(ac1.getDestinationId() == XPilotAPIStrPool::find("KJFK"));
+    CHECK(ac1.getOriginId() != ac2.getOriginId());
+    CHECK(ac1.getModelIcaoId() == XPilotAPIStrPool::find("A321"));
+    CHECK(ac1.getWtcId() == ac2.getWtcId() && ac1.getAcClassId() == ac2.getAcClassId());
+
+    // the description is built once and kept while texts don't change
+    const std::string& descr = ac1.getDescription();
+    CHECK(descr == "DLH400 (A321) EDDF-KJFK");
+    const char* pDescr = descr.data();
+    const std::string_view csView = ac1.getCallSignView();
+    for (int i = 0; i < 5; i++) {
+        backend.bulk(0).lat += 0.01;
+        conn.UpdateAcStore();
+    }
+    CHECK(&ac1.getDescription() == &descr && ac1.getDescription().data() == pDescr);
+    CHECK(ac1.getDescription() == "DLH400 (A321) EDDF-KJFK");
+    // views taken earlier still point to the same, unchanged text
+    CHECK(csView == "DLH400" && csView.data() == ac1.getCallSignView().data());
+
+    // ...and rebuilt after a text change
+    strcpy(backend.info(0).destination, "EGLL");
+    conn.UpdateAcStore();
+    CHECK(ac1.getDescription() == "DLH400 (A321) EDDF-EGLL");
+    CHECK(ac1.getDestinationId() == XPilotAPIStrPool::find("EGLL"));
+    strcpy(backend.info(0).callSign, "");
+    conn.UpdateAcStore();
+    CHECK(ac1.getDescription() == ac1.getKey() + " (A321) EDDF-EGLL");
+
+    // texts filling the whole field are cut to keep them zero-terminated
+    strcpy(backend.info(1).callSign, "ABCDEFG");
+    backend.info(1).callSign[7] = 'H';
+    conn.UpdateAcStore();
+    CHECK(ac2.getCallSignView() == "ABCDEFG");
+
+    // recycle() forgets texts, ids, and the cached description
+    XPilotAPIAircraft ac;
+    XPilotAPIAircraft::XPilotAPIBulkData bulk;
+    bulk.keyNum = 7;
+    CHECK(ac.updateAircraft(bulk, sizeof(bulk)));
+    XPilotAPIAircraft::XPilotAPIBulkInfoTexts info;
+    info.keyNum = 7;
+    strcpy(info.callSign, "BAW1");
+    strcpy(info.origin, "EGLL");
+    CHECK(ac.updateAircraft(info, sizeof(info)));
+    CHECK(ac.getDescription() == "BAW1 EGLL-?");
+    ac.recycle();
+    CHECK(ac.getCallSignView().empty() && ac.getOriginId() == 0);
+    bulk.keyNum = 8;
+    CHECK(ac.updateAircraft(bulk, sizeof(bulk)));
+    CHECK(ac.getDescription() == ac.getKey());
+    info.keyNum = 8;
+    strcpy(info.callSign, "AFR2");
+    CHECK(ac.updateAircraft(info, sizeof(info)));
+    CHECK(ac.getDescription() == "AFR2 EGLL-?");
+
+    return TEST_RESULT();
+}
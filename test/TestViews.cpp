@@ -0,0 +1,204 @@
+/*
+ * Views maintained from change sets compared with brute-force filtering and sorting
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "XPilotAPITest.h"
+
+static const char* aWtc[] = { "H", "M", "L" };
+static const char* aAcClass[] = { "L2J", "L4J", "H1T" };
+static const char* aAirport[] = { "KJFK", "KLAX", "EDDF", "EGLL" };
+static const char* aCallSign[] = { "AAL1", "AAL12", "BAW", "DLH400", "UAL9", "AAL1" };
+
+template <size_t N>
+static const char* Pick(TestRnd& rnd, const char* (&a)[N])
+{
+    return a[size_t(rnd() * N)];
+}
+
+static void SetText(char* dst, size_t size, const char* s)
+{
+    memset(dst, 0, size);
+    strncpy(dst, s, size - 1);
+}
+
+// Random values for all fields queries can look at
+static void Randomize(TestRnd& rnd, XPilotAPITestBackend::BulkTy& bulk)
+{
+    bulk.alt_ft = double(int(rnd() * 40)) * 1000.0;       // often equal: ties
+    bulk.dist_nm = float(int(rnd() * 200));
+    bulk.speed_kt = float(rnd() * 500.0);
+    bulk.bits.onGnd = rnd() < 0.3;
+}
+
+static void Randomize(TestRnd& rnd, XPilotAPITestBackend::InfoTy& info)
+{
+    SetText(info.wtc, sizeof(info.wtc), Pick(rnd, aWtc));
+    SetText(info.acClass, sizeof(info.acClass), Pick(rnd, aAcClass));
+    SetText(info.origin, sizeof(info.origin), Pick(rnd, aAirport));
+    SetText(info.destination, sizeof(info.destination), Pick(rnd, aAirport));
+    SetText(info.callSign, sizeof(info.callSign), Pick(rnd, aCallSign));
+}
+
+// Brute force: all aircraft of the store, filtered and sorted independently of the view
+static std::vector<uint64_t> Expected(const XPilotAPIAcStore& store, const XPilotAPIQuery& q,
+                                      const std::vector<std::string>& vTexts)
+{
+    std::vector<const XPilotAPIAircraft*> vAc;
+    for (int i = 0; i < store.size(); i++) {
+        const XPilotAPIAircraft& ac = *store[i];
+        const XPilotAPIAircraft::XPilotAPIBulkData& bulk = ac.getBulk();
+        const XPilotAPIAircraft::XPilotAPIBulkInfoTexts& info = ac.getInfo();
+        if ((q.gnd == XPilotAPIQuery::GND_ONLY && !bulk.bits.onGnd) ||
+            (q.gnd == XPilotAPIQuery::AIR_ONLY && bulk.bits.onGnd) ||
+            bulk.alt_ft < q.altMinFt || bulk.alt_ft > q.altMaxFt ||
+            bulk.dist_nm < q.distMinNm || bulk.dist_nm > q.distMaxNm ||
+            (!vTexts[0].empty() && vTexts[0] != info.wtc) ||
+            (!vTexts[1].empty() && vTexts[1] != info.acClass) ||
+            (!vTexts[2].empty() && vTexts[2] != info.origin) ||
+            (!vTexts[3].empty() && vTexts[3] != info.destination))
+            continue;
+        vAc.push_back(&ac);
+    }
+
+    auto value = [&](const XPilotAPIAircraft* pAc) {
+        switch (q.sortBy) {
+        case XPilotAPIQuery::SORT_DIST:     return double(pAc->getBulk().dist_nm);
+        case XPilotAPIQuery::SORT_ALT:      return pAc->getBulk().alt_ft;
+        case XPilotAPIQuery::SORT_SPEED:    return double(pAc->getBulk().speed_kt);
+        default:                            return 0.0;
+        }
+    };
+    auto text = [&](const XPilotAPIAircraft* pAc) {
+        return q.sortBy == XPilotAPIQuery::SORT_CALLSIGN ? std::string(pAc->getInfo().callSign).substr(0, 8) : std::string();
+    };
+    std::sort(vAc.begin(), vAc.end(), [&](const XPilotAPIAircraft* a, const XPilotAPIAircraft* b) {
+        const double va = value(a), vb = value(b);
+        if (va != vb)
+            return q.bDescending ? va > vb : va < vb;
+        const std::string ta = text(a), tb = text(b);
+        if (ta != tb)
+            return q.bDescending ? ta > tb : ta < tb;
+        return a->getKeyNum() < b->getKeyNum();
+    });
+
+    std::vector<uint64_t> vKeys;
+    for (const XPilotAPIAircraft* pAc : vAc)
+        vKeys.push_back(pAc->getKeyNum());
+    return vKeys;
+}
+
+struct ViewTy
+{
+    int id = 0;
+    XPilotAPIQuery query;
+    std::vector<std::string> vTexts = std::vector<std::string>(4);   // wtc, acClass, origin, destination
+};
+
+static ViewTy RandomView(TestRnd& rnd)
+{
+    ViewTy v;
+    XPilotAPIQuery& q = v.query;
+    if (rnd() < 0.3)
+        q.gnd = rnd() < 0.5 ? XPilotAPIQuery::GND_ONLY : XPilotAPIQuery::AIR_ONLY;
+    if (rnd() < 0.4) {
+        q.altMinFt = double(int(rnd() * 20)) * 1000.0;
+        q.altMaxFt = q.altMinFt + double(int(rnd() * 20)) * 1000.0;
+    }
+    if (rnd() < 0.3) {
+        q.distMinNm = float(int(rnd() * 50));
+        q.distMaxNm = q.distMinNm + float(int(rnd() * 100));
+    }
+    if (rnd() < 0.2)
+        v.vTexts[0] = Pick(rnd, aWtc);
+    if (rnd() < 0.2)
+        v.vTexts[1] = Pick(rnd, aAcClass);
+    if (rnd() < 0.2)
+        v.vTexts[2] = Pick(rnd, aAirport);
+    if (rnd() < 0.2)
+        v.vTexts[3] = Pick(rnd, aAirport);
+    q.wtc = v.vTexts[0].empty() ? 0 : XPilotAPIStrPool::intern(v.vTexts[0]);
+    q.acClass = v.vTexts[1].empty() ? 0 : XPilotAPIStrPool::intern(v.vTexts[1]);
+    q.origin = v.vTexts[2].empty() ? 0 : XPilotAPIStrPool::intern(v.vTexts[2]);
+    q.destination = v.vTexts[3].empty() ? 0 : XPilotAPIStrPool::intern(v.vTexts[3]);
+    q.sortBy = XPilotAPIQuery::SortTy(int(rnd() * 5));
+    q.bDescending = rnd() < 0.5;
+    if (rnd() < 0.4)
+        q.topK = 1 + int(rnd() * 20);
+    return v;
+}
+
+int main()
+{
+    XPilotAPITestBackend backend;
+    XPilotAPIBackendGuard guard(backend);
+    TestRnd rnd(23);
+    uint64_t nextKey = 1;
+    auto addAc = [&]() {
+        const size_t i = backend.add(nextKey++, 40.0 + rnd(), -74.0 + rnd());
+        Randomize(rnd, backend.bulk(i));
+        Randomize(rnd, backend.info(i));
+    };
+    for (int i = 0; i < 300; i++)
+        addAc();
+
+    XPilotAPIConnect conn;
+    conn.sPeriodExpsv = std::chrono::seconds(0);   // texts with every update
+    conn.UpdateAcStore();
+
+    std::vector<ViewTy> vViews;
+    for (int i = 0; i < 30; i++) {
+        vViews.push_back(RandomView(rnd));
+        vViews.back().id = conn.addView(vViews.back().query);
+    }
+
+    int numChecked = 0;
+    for (int iter = 0; iter < 300; iter++) {
+        // mostly little churn, maintained incrementally, sometimes so much that views are rebuilt
+        const int numChanges = iter % 10 == 9 ? 150 : 1 + int(rnd() * 8);
+        for (int c = 0; c < numChanges; c++) {
+            const double r = rnd();
+            const size_t i = size_t(rnd() * backend.getNumAc());
+            if (r < 0.15 || backend.getNumAc() < 50)
+                addAc();
+            else if (r < 0.3)
+                backend.erase(i);
+            else if (r < 0.7)
+                Randomize(rnd, backend.bulk(i));
+            else
+                Randomize(rnd, backend.info(i));
+        }
+        // now and then replace a view
+        if (iter % 25 == 24) {
+            const size_t v = size_t(rnd() * vViews.size());
+            conn.removeView(vViews[v].id);
+            vViews[v] = RandomView(rnd);
+            vViews[v].id = conn.addView(vViews[v].query);
+        }
+        conn.UpdateAcStore();
+
+        for (const ViewTy& v : vViews) {
+            const XPilotAPIView* pView = conn.getView(v.id);
+            CHECK(pView);
+            if (!pView)
+                continue;
+            const std::vector<uint64_t> vExp = Expected(conn.getAcStore(), v.query, v.vTexts);
+            const int numExp = v.query.topK > 0 ? std::min(v.query.topK, int(vExp.size())) : int(vExp.size());
+            bool bOK = pView->getNumMatching() == int(vExp.size()) && pView->size() == numExp;
+            for (int i = 0; bOK && i < numExp; i++)
+                bOK = pView->keyAt(i) == vExp[size_t(i)] && (*pView)[i].getKeyNum() == vExp[size_t(i)];
+            CHECK(bOK);
+            if (!bOK)
+                fprintf(stderr, "  view %d in iteration %d\n", v.id, iter);
+            numChecked++;
+        }
+    }
+    CHECK(numChecked == 300 * 30);
+
+    return TEST_RESULT();
+}
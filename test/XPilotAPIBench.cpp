@@ -0,0 +1,383 @@
+/*
+ * Benchmark of XPilotAPIConnect on synthetic traffic
+ *
+ * Usage: XPilotAPIBench [--quick] [--check] [section...]
+ *
+ * Sections (all if none given):
+ *  latency  update latency percentiles per fleet size and `numBulkAc` setting
+ *  alloc    heap allocations per update with and without churn
+ *  soa      one pass over all aircraft: SoA arrays vs. objects vs. map
+ *  fetch    XPLMGetDatab calls and bytes per update, fixed vs. automatic chunks
+ *
+ * --quick  fewer fleet sizes and frames
+ * --check  returns non-zero if the expectations documented in the
+ *          README (e.g. no steady-state allocations) aren't met
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "XPilotAPI.h"
+
+//
+// MARK: Allocation counting
+//
+
+static std::atomic<long long> gNumAllocs(0);
+
+static void* CountedAlloc(size_t size)
+{
+    gNumAllocs++;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+static void* CountedAlignedAlloc(size_t size, std::align_val_t align)
+{
+    gNumAllocs++;
+    void* p = nullptr;
+#ifdef _WIN32
+    p = _aligned_malloc(size ? size : 1, size_t(align));
+#else
+    if (posix_memalign(&p, std::max(size_t(align), sizeof(void*)), size ? size : 1))
+        p = nullptr;
+#endif
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+static void AlignedFree(void* p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+void* operator new(size_t size) { return CountedAlloc(size); }
+void* operator new[](size_t size) { return CountedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{ try { return CountedAlloc(size); } catch (...) { return nullptr; } }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{ try { return CountedAlloc(size); } catch (...) { return nullptr; } }
+void* operator new(size_t size, std::align_val_t align) { return CountedAlignedAlloc(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return CountedAlignedAlloc(size, align); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { AlignedFree(p); }
+
+//
+// MARK: Helpers
+//
+
+static bool gQuick = false;
+static int gNumFailed = 0;
+
+// Reports a failed expectation in --check mode
+static void Expect(bool bOk, const char* what)
+{
+    if (!bOk) {
+        fprintf(stderr, "EXPECTATION FAILED: %s\n", what);
+        gNumFailed++;
+    }
+}
+
+// Frame time of the simulated sim loop
+constexpr double FRAME_SEC = 1.0 / 30.0;
+
+static double Percentile(std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    std::sort(v.begin(), v.end());
+    const size_t i = std::min(v.size() - 1, size_t(p / 100.0 * double(v.size())));
+    return v[i];
+}
+
+static const char* BulkAcName(int numBulkAc)
+{
+    static char buf[16];
+    if (numBulkAc == XPilotAPIConnect::BULK_AC_AUTO)
+        return "auto";
+    snprintf(buf, sizeof(buf), "%d", numBulkAc);
+    return buf;
+}
+
+//
+// MARK: Sections
+//
+
+// Update latency percentiles: one row per fleet size and chunk setting,
+// read along a column for the scaling curve
+static void BenchLatency()
+{
+    const std::vector<int> vNumAc = gQuick ? std::vector<int>{ 100, 1000 } :
+                                             std::vector<int>{ 10, 100, 1000, 5000, 10000 };
+    const std::vector<int> vBulkAc = { 25, 50, 100, XPilotAPIConnect::BULK_AC_AUTO };
+    const int numFrames = gQuick ? 60 : 600;
+
+    printf("\n== latency: UpdateAcStore() per frame, 1%% churn per second, %d frames\n", numFrames);
+    printf("%7s %9s %9s %9s %9s %9s %10s\n", "numAc", "numBulkAc", "p50 us", "p90 us", "p99 us", "max us", "calls/upd");
+    for (int numAc : vNumAc) {
+        for (int numBulkAc : vBulkAc) {
+            XPilotAPISyntheticBackend::ConfigTy cfg;
+            cfg.numAc = numAc;
+            cfg.churnPerSec = numAc / 100.0;
+            XPilotAPISyntheticBackend backend(cfg);
+            XPilotAPIBackend::set(&backend);
+            {
+                XPilotAPIConnect conn(XPilotAPIAircraft::CreateNewObject, numBulkAc);
+                for (int i = 0; i < 30; i++) {
+                    backend.step(FRAME_SEC);
+                    conn.UpdateAcStore();
+                }
+                std::vector<double> vUs;
+                vUs.reserve(size_t(numFrames));
+                backend.resetCounters();
+                for (int i = 0; i < numFrames; i++) {
+                    backend.step(FRAME_SEC);
+                    const auto t0 = std::chrono::steady_clock::now();
+                    conn.UpdateAcStore();
+                    vUs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+                }
+                const double calls = double(backend.numDatabCalls) / numFrames;
+                printf("%7d %9s %9.1f %9.1f %9.1f %9.1f %10.1f\n", numAc, BulkAcName(numBulkAc),
+                       Percentile(vUs, 50), Percentile(vUs, 90), Percentile(vUs, 99), Percentile(vUs, 100), calls);
+            }
+            XPilotAPIBackend::set(nullptr);
+        }
+    }
+}
+
+static void Update(XPilotAPIConnect& conn, bool bMap)
+{
+    if (bMap)
+        conn.UpdateAcList();
+    else
+        conn.UpdateAcStore();
+}
+
+// Heap allocations during UpdateAcStore() (or UpdateAcList() if `bMap`) after warm-up
+static long long CountAllocs(int numAc, double churnPerSec, XPilotAPIConnect::fCreateAcObject* pfCreate,
+                             bool bMap, int numFrames)
+{
+    XPilotAPISyntheticBackend::ConfigTy cfg;
+    cfg.numAc = numAc;
+    cfg.churnPerSec = churnPerSec;
+    XPilotAPISyntheticBackend backend(cfg);
+    XPilotAPIBackend::set(&backend);
+    long long numAllocs = 0;
+    {
+        XPilotAPIConnect conn(pfCreate, XPilotAPIConnect::BULK_AC_AUTO);
+        // warm-up: buffers reach their size, the pool fills, all texts are known
+        for (int i = 0; i < 300; i++) {
+            backend.step(FRAME_SEC);
+            Update(conn, bMap);
+        }
+        for (int i = 0; i < numFrames; i++) {
+            backend.step(FRAME_SEC);
+            const long long before = gNumAllocs;
+            Update(conn, bMap);
+            numAllocs += gNumAllocs - before;
+        }
+    }
+    XPilotAPIBackend::set(nullptr);
+    return numAllocs;
+}
+
+static XPilotAPIAircraft* CreateOwnObject()
+{
+    return new XPilotAPIAircraft();
+}
+
+// Allocations per 100 updates
+static void BenchAlloc()
+{
+    const int numFrames = gQuick ? 300 : 3000;
+    const int numAc = 1000;
+    printf("\n== alloc: heap allocations per 100 updates, %d aircraft, %d frames after warm-up\n", numAc, numFrames);
+    printf("%-34s %12s %12s %12s\n", "factory", "no churn", "30 ac/s", "300 ac/s");
+
+    // Own factories disable recycling, so each new aircraft costs its object
+    // and the shared pointer's control block
+    struct {
+        const char* name;
+        XPilotAPIConnect::fCreateAcObject* pfCreate;
+        bool bMap;
+        bool bExpectZero;
+    } aCases[] = {
+        { "CreateNewObject (recycling)", XPilotAPIAircraft::CreateNewObject, false, true },
+        { "CreateNewObject, UpdateAcList()", XPilotAPIAircraft::CreateNewObject, true, true },
+        { "own factory (no recycling)", CreateOwnObject, false, false },
+    };
+    for (const auto& c : aCases) {
+        const long long a0 = CountAllocs(numAc, 0.0, c.pfCreate, c.bMap, numFrames);
+        const long long a1 = CountAllocs(numAc, 30.0, c.pfCreate, c.bMap, numFrames);
+        const long long a2 = CountAllocs(numAc, 300.0, c.pfCreate, c.bMap, numFrames);
+        printf("%-34s %12.1f %12.1f %12.1f\n", c.name,
+               a0 * 100.0 / numFrames, a1 * 100.0 / numFrames, a2 * 100.0 / numFrames);
+        if (c.bExpectZero) {
+            Expect(a0 == 0, "no allocations in steady state without churn");
+            Expect(a1 == 0, "no allocations in steady state with churn");
+        }
+    }
+}
+
+// A typical per-frame pass: aircraft airborne within a lat/lon box and
+// their mean altitude. Runs over the SoA arrays, over the objects in the
+// store, and over the compatibility map.
+static void BenchSoA()
+{
+    const std::vector<int> vNumAc = gQuick ? std::vector<int>{ 1000 } :
+                                             std::vector<int>{ 1000, 10000 };
+    const int numReps = gQuick ? 50 : 500;
+
+    printf("\n== soa: one pass over all aircraft, median of %d passes\n", numReps);
+    printf("%7s %12s %12s %12s\n", "numAc", "SoA us", "objects us", "map us");
+    for (int numAc : vNumAc) {
+        XPilotAPISyntheticBackend::ConfigTy cfg;
+        cfg.numAc = numAc;
+        XPilotAPISyntheticBackend backend(cfg);
+        XPilotAPIBackend::set(&backend);
+        {
+            XPilotAPIConnect conn(XPilotAPIAircraft::CreateNewObject, XPilotAPIConnect::BULK_AC_AUTO);
+            backend.step(FRAME_SEC);
+            conn.UpdateAcList();
+            const double latMin = cfg.centerLat - 0.5, latMax = cfg.centerLat + 0.5;
+            const double lonMin = cfg.centerLon - 0.5, lonMax = cfg.centerLon + 0.5;
+            volatile double sink = 0.0;
+
+            auto timeUs = [&](auto pass) {
+                std::vector<double> vUs;
+                for (int r = 0; r < numReps; r++) {
+                    const auto t0 = std::chrono::steady_clock::now();
+                    sink = sink + pass();
+                    vUs.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+                }
+                return Percentile(vUs, 50);
+            };
+
+            const XPilotAPIFleetSoA& soa = conn.getFleetSoA();
+            const double usSoA = timeUs([&]() {
+                double sum = 0.0;
+                int n = 0;
+                for (int i = 0; i < soa.size(); i++) {
+                    const bool b = soa.lat[size_t(i)] >= latMin && soa.lat[size_t(i)] <= latMax &&
+                                   soa.lon[size_t(i)] >= lonMin && soa.lon[size_t(i)] <= lonMax &&
+                                   !(soa.bits[size_t(i)] & XPilotAPIFleetSoA::BIT_ON_GND);
+                    sum += b ? soa.alt_ft[size_t(i)] : 0.0;
+                    n += b;
+                }
+                return n ? sum / n : 0.0;
+            });
+            auto passAc = [&](const XPilotAPIAircraft& ac, double& sum, int& n) {
+                if (ac.getLat() >= latMin && ac.getLat() <= latMax &&
+                    ac.getLon() >= lonMin && ac.getLon() <= lonMax && !ac.isOnGround()) {
+                    sum += ac.getAltFt();
+                    n++;
+                }
+            };
+            const double usObj = timeUs([&]() {
+                double sum = 0.0;
+                int n = 0;
+                for (const SPtrXPilotAPIAircraft& pAc : conn.getAcStore())
+                    passAc(*pAc, sum, n);
+                return n ? sum / n : 0.0;
+            });
+            const double usMap = timeUs([&]() {
+                double sum = 0.0;
+                int n = 0;
+                for (const auto& e : conn.getAcMap())
+                    passAc(*e.second, sum, n);
+                return n ? sum / n : 0.0;
+            });
+            printf("%7d %12.1f %12.1f %12.1f\n", numAc, usSoA, usObj, usMap);
+        }
+        XPilotAPIBackend::set(nullptr);
+    }
+}
+
+// XPLMGetDatab calls and bytes per update, including size queries
+static void BenchFetch()
+{
+    const std::vector<int> vNumAc = { 100, 1000, 5000 };
+    const std::vector<int> vBulkAc = { 50, XPilotAPIConnect::BULK_AC_AUTO };
+    const int numFrames = gQuick ? 30 : 300;
+
+    printf("\n== fetch: XPLMGetDatab per UpdateAcStore(), %d frames\n", numFrames);
+    printf("%7s %9s %10s %10s\n", "numAc", "numBulkAc", "calls/upd", "KB/upd");
+    for (int numAc : vNumAc) {
+        for (int numBulkAc : vBulkAc) {
+            XPilotAPISyntheticBackend::ConfigTy cfg;
+            cfg.numAc = numAc;
+            XPilotAPISyntheticBackend backend(cfg);
+            XPilotAPIBackend::set(&backend);
+            {
+                XPilotAPIConnect conn(XPilotAPIAircraft::CreateNewObject, numBulkAc);
+                backend.step(FRAME_SEC);
+                conn.UpdateAcStore();
+                backend.resetCounters();
+                for (int i = 0; i < numFrames; i++) {
+                    backend.step(FRAME_SEC);
+                    conn.UpdateAcStore();
+                }
+                printf("%7d %9s %10.1f %10.1f\n", numAc, BulkAcName(numBulkAc),
+                       double(backend.numDatabCalls) / numFrames,
+                       double(backend.numDatabBytes) / numFrames / 1024.0);
+            }
+            XPilotAPIBackend::set(nullptr);
+        }
+    }
+}
+
+//
+// MARK: main
+//
+
+int main(int argc, char* argv[])
+{
+    bool bCheck = false;
+    std::vector<std::string> vSections;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quick"))
+            gQuick = true;
+        else if (!strcmp(argv[i], "--check"))
+            bCheck = true;
+        else
+            vSections.push_back(argv[i]);
+    }
+    auto want = [&](const char* s) {
+        return vSections.empty() || std::find(vSections.begin(), vSections.end(), s) != vSections.end();
+    };
+
+    if (want("latency"))
+        BenchLatency();
+    if (want("alloc"))
+        BenchAlloc();
+    if (want("soa"))
+        BenchSoA();
+    if (want("fetch"))
+        BenchFetch();
+
+    if (bCheck && gNumFailed) {
+        fprintf(stderr, "%d expectation(s) failed\n", gNumFailed);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
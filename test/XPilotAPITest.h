@@ -0,0 +1,97 @@
+/*
+ * Minimal helpers for the tests of the xPilot API
+ */
+
+#ifndef XPilotAPITest_h
+#define XPilotAPITest_h
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "XPilotAPI.h"
+
+// Number of failed checks so far
+inline int& XPilotAPITestFailures()
+{
+    static int numFailures = 0;
+    return numFailures;
+}
+
+// Checks a condition, also in release builds, and continues on failure
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            XPilotAPITestFailures()++;                                      \
+        }                                                                   \
+    } while (0)
+
+// Result for main()
+#define TEST_RESULT()                                                       \
+    (XPilotAPITestFailures() ? (fprintf(stderr, "%d check(s) failed\n", XPilotAPITestFailures()), EXIT_FAILURE) : EXIT_SUCCESS)
+
+// Backend serving exactly the aircraft a test puts into it
+class XPilotAPITestBackend : public XPilotAPIArrayBackend
+{
+public:
+    typedef XPilotAPIAircraft::XPilotAPIBulkData BulkTy;
+    typedef XPilotAPIAircraft::XPilotAPIBulkInfoTexts InfoTy;
+
+    // Adds an aircraft at the end of xPilot's arrays, returns its position
+    size_t add(uint64_t key, double lat, double lon, double alt_ft = 5000.0, const char* callSign = "")
+    {
+        BulkTy bulk;
+        bulk.keyNum = key;
+        bulk.lat = lat;
+        bulk.lon = lon;
+        bulk.alt_ft = alt_ft;
+        vBulk.push_back(bulk);
+        InfoTy info;
+        info.keyNum = key;
+        strncpy(info.callSign, callSign, sizeof(info.callSign) - 1);
+        vInfo.push_back(info);
+        return vBulk.size() - 1;
+    }
+    // Removes the aircraft at position `i`, moving the following ones forward
+    void erase(size_t i)
+    {
+        vBulk.erase(vBulk.begin() + ptrdiff_t(i));
+        vInfo.erase(vInfo.begin() + ptrdiff_t(i));
+    }
+    void clear() { vBulk.clear(); vInfo.clear(); }
+    BulkTy& bulk(size_t i) { return vBulk[i]; }
+    InfoTy& info(size_t i) { return vInfo[i]; }
+};
+
+// Installs a backend for the lifetime of this object
+struct XPilotAPIBackendGuard
+{
+    XPilotAPIBackendGuard(XPilotAPIBackend& backend) { XPilotAPIBackend::set(&backend); }
+    ~XPilotAPIBackendGuard() { XPilotAPIBackend::set(nullptr); }
+};
+
+// Great circle distance in nautical miles, for brute-force comparisons
+inline double TestDistNm(double lat1, double lon1, double lat2, double lon2)
+{
+    const double D2R = 3.14159265358979323846 / 180.0;
+    const double sLat = std::sin((lat2 - lat1) * D2R / 2.0);
+    const double sLon = std::sin((lon2 - lon1) * D2R / 2.0);
+    const double h = sLat * sLat + std::cos(lat1 * D2R) * std::cos(lat2 * D2R) * sLon * sLon;
+    return 2.0 * 3440.065 * std::asin(std::sqrt(std::min(h, 1.0)));
+}
+
+// Simple deterministic pseudo-random numbers in [0, 1)
+struct TestRnd
+{
+    uint64_t state;
+    explicit TestRnd(uint64_t seed = 1) : state(seed * 0x9E3779B97F4A7C15ull + 1) {}
+    double operator()()
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return double(state >> 11) / double(1ull << 53);
+    }
+};
+
+#endif // XPilotAPITest_h